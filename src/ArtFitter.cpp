@@ -0,0 +1,167 @@
+#include "ArtFitter.hpp"
+#include "FitStrategies.hpp"
+#include "SquareMap.hpp"
+#include <array>
+#include <optional>
+#include <vector>
+
+using namespace objects;
+using namespace fitting;
+
+namespace {
+    struct OWOShape {
+        int id;
+        // gd object used for the shape and how many pixels wide it is
+        int objectID;
+        int size;
+    };
+
+    // initialize the objects, pls dont question the name
+    // biggest first, any size can go in here as the square map knows every size
+    // an array so there is nothing to free when the mod goes away while a refiner uses it
+    constexpr std::array<OWOShape, 4> OWOshapes = {{
+        // LargePixelObjID - checks this first as it's a big boy
+        {3, largePixelObjID, 6},
+        // bigPixelObjID
+        {2, bigPixelObjID, 3},
+        // medPixelObjID
+        {1, medPixelObjID, 2},
+        // PixelObjID
+        {0, pixelObjID, 1},
+    }};
+}
+
+Generator<ObjectRecord> fitting::fitSquares(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena& arena) {
+    int width = image.width;
+    int height = image.height;
+    // contains the pixels that have been placed
+    PixelMask placed(width, height, arena);
+    // only the squares need it, plain pixels never look at their neighbours
+    std::optional<SquareMap> squares;
+    if (settings.optimise && !settings.useOldObject) {
+        squares.emplace(image, arena);
+    }
+    // loops through image data
+    for (int y = height - 1; y >= 0; --y) {
+        // checks the time limit at the start of each row, plain pixels are never slow
+        if (settings.optimise && !settings.useOldObject) {
+            passedDeadline(settings, report, y);
+        }
+        for (int x = 0; x < width;) {
+            // checks if there is a pixel
+            if (placed.test(x, y) || !image.isOpaque(x, y)) {
+                x++;
+                continue;
+            }
+            uint32_t colour = image.colour(x, y);
+            // checks if the old pixel is not being used or basic op is on
+            if (settings.optimise && !settings.useOldObject && !report.pastDeadline) {
+                // loops through the different shapes (these represent GD objects)
+                int side = squares->side(x, y);
+                for (const auto& shape : OWOshapes) {
+                    // the biggest square of this colour here has to be at least as big as the shape
+                    if (shape.size > side) {
+                        continue;
+                    }
+                    for (int row = 0; row < shape.size; ++row) {
+                        for (int column = 0; column < shape.size; ++column) {
+                            placed.set(x + column, y - row);
+                        }
+                    }
+                    ObjectRecord record{shape.objectID, x, y, shape.size, shape.size, colour};
+                    // single pixels stretch along x first and then along y
+                    if (shape.id == 0 && settings.useScaling) {
+                        if (x + 1 < width && canTake(image, placed, x + 1, y, x, y)) {
+                            while (x + record.width < width &&
+                            canTake(image, placed, x + record.width, y, x, y)) {
+                                placed.set(x + record.width, y);
+                                record.width++;
+                            }
+                        }
+                        else if (y - 1 >= 0 && canTake(image, placed, x, y - 1, x, y)) {
+                            while (y - record.height >= 0 &&
+                            canTake(image, placed, x, y - record.height, x, y)) {
+                                placed.set(x, y - record.height);
+                                record.height++;
+                            }
+                        }
+                    }
+                    // the 2 by 2 stretches along x while both of its rows match
+                    else if (shape.id == 1 && settings.useScaling) {
+                        while (x + record.width < width &&
+                        canTake(image, placed, x + record.width, y, x, y) &&
+                        canTake(image, placed, x + record.width, y - 1, x, y)) {
+                            placed.set(x + record.width, y);
+                            placed.set(x + record.width, y - 1);
+                            record.width++;
+                        }
+                    }
+                    co_yield record;
+                    // skips the pixels the object covers on this row
+                    x += record.width;
+                    break;
+                }
+            }
+            // out of time so the pixel is stretched along its row instead
+            else if (report.pastDeadline) {
+                auto record = takeRow(image, placed, x, y);
+                co_yield record;
+                x += record.width;
+            }
+            // if no opt is used
+            else {
+                placed.set(x, y);
+                co_yield ObjectRecord{settings.useOldObject ? oldPixelObjID : pixelObjID, x, y, 1, 1, colour};
+                x++;
+            }
+        }
+    }
+}
+
+Generator<ObjectRecord> fitArt(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena& arena) {
+    // the old pixel can not be scaled so it is always one object per pixel
+    if (settings.useOldObject) {
+        return fitSquares(image, settings, report, arena);
+    }
+    // squares can not be stretched over a seam and the budget needs every colour at once, the
+    // layered mode's background runs under whole areas so the seams cut it up into a lot more objects
+    if (settings.parallelTiles && settings.mode != FitMode::Squares && settings.mode != FitMode::Budget &&
+        settings.mode != FitMode::Layered) {
+        return fitTiles(image, settings, report, arena);
+    }
+    switch (settings.mode) {
+        case FitMode::Rectangles: return fitRectangles(image, settings, report, arena);
+        case FitMode::Partition: return fitPartition(image, settings, report, arena);
+        case FitMode::Runs: return fitRuns(image, settings, report, arena);
+        case FitMode::Layered: return fitLayered(image, settings, report, arena);
+        case FitMode::Quadtree: return fitQuadtree(image, settings, report, arena);
+        case FitMode::Budget: return fitBudget(image, settings, report, arena);
+        case FitMode::Squares: break;
+    }
+    return fitSquares(image, settings, report, arena);
+}
+
+char const* fitModeName(FitMode mode) {
+    switch (mode) {
+        case FitMode::Squares: return "Squares";
+        case FitMode::Rectangles: return "Rectangles";
+        case FitMode::Partition: return "Partition";
+        case FitMode::Runs: return "Runs";
+        case FitMode::Layered: return "Layered";
+        case FitMode::Quadtree: return "Quadtree";
+        case FitMode::Budget: return "Budget";
+    }
+    return "Squares";
+}
+
+std::optional<FitMode> fitModeFromName(std::string_view name) {
+    for (auto mode : {FitMode::Squares, FitMode::Rectangles, FitMode::Partition, FitMode::Runs,
+        FitMode::Layered, FitMode::Quadtree, FitMode::Budget}) {
+        if (name == fitModeName(mode)) {
+            return mode;
+        }
+    }
+    return std::nullopt;
+}
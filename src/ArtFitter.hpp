@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string_view>
+#include "Generator.hpp"
+#include "ImageView.hpp"
+#include "ImportArena.hpp"
+#include "ObjectRecord.hpp"
+
+class ThreadPool;
+
+// how the pixels are grouped into objects
+enum class FitMode {
+    // the 4 square objects, with the scaling settings
+    Squares,
+    // each object grows into the biggest same coloured rectangle it can using the x and y scale
+    Rectangles,
+    // splits each same coloured area into the fewest rectangles possible, slower than rectangles
+    Partition,
+    // stacks identical runs of one colour from row to row, the fastest mode after plain pixels
+    Runs,
+    // puts the most common colour on a lower layer under the rest so it needs far fewer objects
+    Layered,
+    // splits the image into squares that halve until each one is a single colour
+    Quadtree,
+    // merges the closest colours together until the rectangles fit in the object budget, this loses detail
+    Budget,
+};
+
+// names used by the fitting mode setting
+char const* fitModeName(FitMode mode);
+std::optional<FitMode> fitModeFromName(std::string_view name);
+
+// the settings that change how pixels are turned into objects
+struct FitSettings {
+    // uses the 4 square objects instead of one object per pixel
+    bool optimise = true;
+    // stretches objects over pixels of the same colour
+    bool useScaling = false;
+    // uses the 2.1 pixel object, this can not be optimised
+    bool useOldObject = false;
+    // once this passes the rest of the image is done as plain rows
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    // set from another thread to cut the fit short, it then finishes like the deadline passed
+    std::atomic<bool> const* cancelled = nullptr;
+    // optimise and useScaling only apply to the squares
+    FitMode mode = FitMode::Squares;
+    // most objects the budget mode can use, 0 means it is the same as rectangles
+    size_t objectBudget = 0;
+    // modes that fit each region on its own spread them over this, without one it all runs here
+    ThreadPool* pool = nullptr;
+    // fits bands of rows at once on the pool and joins the objects back up across the seams,
+    // only for the rectangles, partition, runs and quadtree modes
+    bool parallelTiles = false;
+
+    // the deadline passed or the fit was cancelled
+    bool outOfTime() const {
+        return (cancelled && *cancelled) || (deadline && std::chrono::steady_clock::now() > *deadline);
+    }
+};
+
+// what happened while fitting, filled in as the records are read
+struct FitReport {
+    // the deadline was hit and the top rows fell back to plain rows
+    bool pastDeadline = false;
+    int fallbackRows = 0;
+    // areas the partition mode ran out of time on and fitted like the rectangles mode instead
+    int fallbackRegions = 0;
+    // the budget mode changed colours to fit, and by how much in delta e summed over the pixels
+    bool coloursMerged = false;
+    bool overBudget = false;
+    double colourError = 0;
+    size_t colourPixels = 0;
+};
+
+// fits objects over the image, one record at a time
+// the image data, report and arena have to outlive the generator
+Generator<ObjectRecord> fitArt(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena& arena);
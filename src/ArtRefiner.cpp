@@ -0,0 +1,132 @@
+#include "ArtRefiner.hpp"
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include "Colour.hpp"
+#include "CoverageVerifier.hpp"
+#include "ImportArena.hpp"
+#include "ImportTrace.hpp"
+#include "ObjectStore.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+    // every refiner with a thread, so they can all be stopped when the mod goes away, these are
+    // never freed so they are still there if an editor is closed after the statics are gone
+    std::mutex& liveRefinersMutex() {
+        static auto* mutex = new std::mutex;
+        return *mutex;
+    }
+
+    std::vector<ArtRefiner*>& liveRefiners() {
+        static auto* refiners = new std::vector<ArtRefiner*>;
+        return *refiners;
+    }
+}
+
+ArtRefiner::ArtRefiner(ImageView image, FitSettings settings, std::vector<FitMode> modes, ArtOrigin origin,
+    size_t importedObjects, std::chrono::steady_clock::duration timeLimit) {
+    auto& state = m_state;
+    state.pixels.assign(image.data, image.data + static_cast<size_t>(image.width) * image.height * image.channels);
+    state.image = ImageView{state.pixels.data(), image.width, image.height, image.channels};
+    state.settings = settings;
+    state.modes = std::move(modes);
+    state.origin = origin;
+    state.bestObjects = importedObjects;
+    // the shared pool can be remade when the thread setting changes, and refining should
+    // not take cores from the editor anyway, so it all runs on the one thread
+    state.settings.pool = nullptr;
+    // with one thread the tiles are no quicker and the seams only add objects
+    state.settings.parallelTiles = false;
+    state.settings.deadline = std::chrono::steady_clock::now() + timeLimit;
+    // stopping cuts the fit short so the thread can be joined without the editor waiting
+    state.settings.cancelled = &state.stopping;
+    {
+        std::lock_guard lock(liveRefinersMutex());
+        liveRefiners().push_back(this);
+    }
+    m_thread = std::thread(run, std::ref(m_state));
+}
+
+ArtRefiner::~ArtRefiner() {
+    join();
+    std::lock_guard lock(liveRefinersMutex());
+    auto& refiners = liveRefiners();
+    refiners.erase(std::remove(refiners.begin(), refiners.end(), this), refiners.end());
+}
+
+void ArtRefiner::join() {
+    stop();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void ArtRefiner::stopAll() {
+    std::lock_guard lock(liveRefinersMutex());
+    for (auto* refiner : liveRefiners()) {
+        refiner->join();
+    }
+}
+
+std::optional<ArtRefiner::Improvement> ArtRefiner::takeImprovement() {
+    std::lock_guard lock(m_state.mutex);
+    return std::exchange(m_state.improvement, std::nullopt);
+}
+
+void ArtRefiner::run(State& state) {
+    // it starts during the import but is not part of it
+    ImportTrace::ignoreThisThread();
+    // no workers, the level string is written on this thread too
+    ThreadPool pool(0);
+    for (FitMode mode : state.modes) {
+        if (state.settings.outOfTime()) {
+            break;
+        }
+        ImportArena arena;
+        ObjectStore objects(arena);
+        FitReport report;
+        auto settings = state.settings;
+        settings.mode = mode;
+        bool gaveUp = false;
+        for (auto const& record : fitArt(state.image, settings, report, arena)) {
+            // gives up on this fit as soon as it can not win or it was stopped
+            if (state.stopping || objects.size() + 1 >= state.bestObjects) {
+                gaveUp = true;
+                break;
+            }
+            objects.push(record);
+        }
+        // one that ran out of time still covers the art with plain rows, so it can win as well
+        if (gaveUp) {
+            continue;
+        }
+        // it replaces art that is already right so it is checked before it is handed over
+        if (!verifyCoverage(state.image, objects, VerifyOptions{mode == FitMode::Squares}).passed() ||
+            state.stopping) {
+            continue;
+        }
+        ColourPalette palette(objects.colours(), pool, arena);
+        auto levelString = buildLevelString(objects, state.origin, palette, pool, arena);
+        std::lock_guard lock(state.mutex);
+        state.improvement = Improvement{std::string(levelString.c_str(), levelString.size()), objects.size(),
+            mode};
+        state.bestObjects = objects.size();
+    }
+    state.finished = true;
+}
+
+std::vector<FitMode> refinementModes(FitSettings const& settings) {
+    // the 2.1 pixels are always one per pixel and the budget mode is meant to lose detail
+    if (settings.useOldObject || settings.mode == FitMode::Budget) {
+        return {};
+    }
+    // the quick import uses runs, then the mode picked in the settings gets a go and after
+    // that the ones that usually make the fewest objects, slowest last
+    std::vector<FitMode> modes;
+    for (FitMode mode : {settings.mode, FitMode::Rectangles, FitMode::Layered, FitMode::Partition}) {
+        if (mode != FitMode::Runs && std::find(modes.begin(), modes.end(), mode) == modes.end()) {
+            modes.push_back(mode);
+        }
+    }
+    return modes;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ArtFitter.hpp"
+#include "ImageView.hpp"
+#include "LevelString.hpp"
+
+// fits the art again in the slower modes on its own thread after a quick import,
+// keeping the level string of any fit with fewer objects than the art in the level
+class ArtRefiner {
+public:
+    // a fit with fewer objects, ready to replace what is in the level
+    struct Improvement {
+        std::string levelString;
+        size_t objects;
+        FitMode mode;
+    };
+
+    // copies the image so it can be freed straight away, the modes are tried in order
+    // until they run out or the time is up
+    ArtRefiner(ImageView image, FitSettings settings, std::vector<FitMode> modes, ArtOrigin origin,
+        size_t importedObjects, std::chrono::steady_clock::duration timeLimit);
+    // stops it and waits for the thread, the fit going on is cut short so this is quick
+    ~ArtRefiner();
+
+    ArtRefiner(const ArtRefiner&) = delete;
+    ArtRefiner& operator=(const ArtRefiner&) = delete;
+
+    // asks it to stop, a fit that is going on is thrown away
+    void stop() { m_state.stopping = true; }
+    // every mode was tried, it ran out of time or it was stopped
+    bool finished() const { return m_state.finished; }
+    // objects in the best fit found so far, including the one that was imported
+    size_t bestObjects() const { return m_state.bestObjects; }
+    // the best fit found since this was last called, if there was one
+    std::optional<Improvement> takeImprovement();
+
+    // stops every refiner and waits for their threads, for when the mod is unloaded while one
+    // is still going, they use the fitters' statics, call it on the main thread
+    static void stopAll();
+
+private:
+    // everything the thread uses
+    struct State {
+        std::vector<unsigned char> pixels;
+        ImageView image;
+        FitSettings settings;
+        std::vector<FitMode> modes;
+        ArtOrigin origin;
+        std::atomic<size_t> bestObjects;
+        std::atomic<bool> stopping{false};
+        std::atomic<bool> finished{false};
+        std::mutex mutex;
+        std::optional<Improvement> improvement;
+    };
+
+    static void run(State& state);
+    // stops the thread and waits for it, it is fine to call again
+    void join();
+
+    State m_state;
+    // started last so the state is ready by then
+    std::thread m_thread;
+};
+
+// the modes worth refining with after a quick import in the given mode, none for
+// modes that are already one object per pixel or change the colours
+std::vector<FitMode> refinementModes(FitSettings const& settings);
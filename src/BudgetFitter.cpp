@@ -0,0 +1,392 @@
+#include "FitStrategies.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "Colour.hpp"
+#include "RegionLabels.hpp"
+
+using namespace objects;
+
+namespace {
+    // the queue is rebuilt once it has this many pairs per region left, plus a bit for small images
+    constexpr size_t maxQueuedPerRegion = 16;
+    constexpr size_t minQueueRebuild = 65536;
+    // one pass merges at most down to a quarter of the regions left
+    constexpr size_t maxShrinkPerPass = 4;
+    // looking for the fewest merges that fit stops once it is this close, as a share of the regions
+    constexpr size_t bisectPrecision = 64;
+
+    // a pair of touching regions and what merging them would cost, the versions
+    // say if either region changed since so old pairs can be skipped
+    struct MergeCandidate {
+        double cost;
+        uint32_t first;
+        uint32_t second;
+        uint32_t firstVersion;
+        uint32_t secondVersion;
+
+        bool operator>(MergeCandidate const& other) const { return cost > other.cost; }
+    };
+
+    // colours are summed so the average is exact however many regions are merged
+    struct ColourSum {
+        double red = 0;
+        double green = 0;
+        double blue = 0;
+        size_t pixels = 0;
+
+        void add(ColourSum const& other) {
+            red += other.red;
+            green += other.green;
+            blue += other.blue;
+            pixels += other.pixels;
+        }
+    };
+
+    // merges touching regions, cheapest first, where the cost is how far the colours are
+    // apart in lab weighted by the pixels that would change (ward's criterion)
+    // every merge is written down so the colours at any point along the way can be worked out
+    // again, merges can not be undone and copying the merger to go back to is slow
+    class RegionMerger {
+    public:
+        RegionMerger(ImageView const& image, RegionLabels const& labels)
+            : m_parents(labels.regions().size()), m_merged(labels.regions().size()),
+            m_initial(labels.regions().size()), m_active(labels.regions().size()),
+            m_seen(labels.regions().size(), 0) {
+            auto const& regions = labels.regions();
+            for (uint32_t i = 0; i < regions.size(); ++i) {
+                m_parents[i] = i;
+                auto& sum = m_initial[i];
+                sum.pixels = regions[i].pixels;
+                sum.red = static_cast<double>(colourRed(regions[i].colour)) * sum.pixels;
+                sum.green = static_cast<double>(colourGreen(regions[i].colour)) * sum.pixels;
+                sum.blue = static_cast<double>(colourBlue(regions[i].colour)) * sum.pixels;
+                auto& merged = m_merged[i];
+                merged.sum = sum;
+                merged.lab = rgbToLab(colourRed(regions[i].colour), colourGreen(regions[i].colour),
+                    colourBlue(regions[i].colour));
+            }
+            // every pair of regions that touch, found from each pixel's right and lower neighbour
+            std::vector<uint64_t> pairs;
+            for (int y = 0; y < image.height; ++y) {
+                for (int x = 0; x < image.width; ++x) {
+                    uint32_t label = labels.label(x, y);
+                    if (label == RegionLabels::noRegion) {
+                        continue;
+                    }
+                    auto addPair = [&](uint32_t other) {
+                        if (other != RegionLabels::noRegion && other != label) {
+                            pairs.push_back((static_cast<uint64_t>(std::min(label, other)) << 32) |
+                                std::max(label, other));
+                        }
+                    };
+                    if (x + 1 < image.width) {
+                        addPair(labels.label(x + 1, y));
+                    }
+                    if (y + 1 < image.height) {
+                        addPair(labels.label(x, y + 1));
+                    }
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+            for (uint64_t pair : pairs) {
+                auto first = static_cast<uint32_t>(pair >> 32);
+                auto second = static_cast<uint32_t>(pair);
+                m_merged[first].neighbours.push_back(second);
+                m_merged[second].neighbours.push_back(first);
+                push(first, second);
+            }
+        }
+
+        size_t regionCount() const { return m_active; }
+
+        // merges until there are only target regions left, false if there was nothing left
+        // to merge or the deadline passed
+        bool mergeDownTo(size_t target, FitSettings const& settings) {
+            size_t merges = 0;
+            while (m_active > target) {
+                if (m_queue.empty()) {
+                    return false;
+                }
+                if (++merges % 1024 == 0 && settings.outOfTime()) {
+                    return false;
+                }
+                auto candidate = m_queue.top();
+                m_queue.pop();
+                if (m_merged[candidate.first].version != candidate.firstVersion ||
+                m_merged[candidate.second].version != candidate.secondVersion) {
+                    continue;
+                }
+                merge(candidate.first, candidate.second);
+                // every merge queues its region's pairs again so old ones are thrown out now and then
+                if (m_queue.size() > m_active * maxQueuedPerRegion + minQueueRebuild) {
+                    rebuildQueue();
+                }
+            }
+            return true;
+        }
+
+        // the colour every original region had when the merges got it down to this many regions,
+        // which can not be fewer than there are now, the merges so far are played again from the start
+        std::vector<uint32_t> regionColours(size_t regions) const {
+            size_t merges = std::min(m_parents.size() - regions, m_merges.size());
+            std::vector<uint32_t> parents(m_parents.size());
+            std::vector<ColourSum> sums(m_initial);
+            for (uint32_t i = 0; i < parents.size(); ++i) {
+                parents[i] = i;
+            }
+            // each merge is between two regions that had not been merged into anything yet
+            for (size_t i = 0; i < merges; ++i) {
+                auto [kept, gone] = m_merges[i];
+                parents[gone] = kept;
+                sums[kept].add(sums[gone]);
+            }
+            std::vector<uint32_t> colours(parents.size());
+            for (uint32_t i = 0; i < colours.size(); ++i) {
+                uint32_t root = i;
+                while (parents[root] != root) {
+                    parents[root] = parents[parents[root]];
+                    root = parents[root];
+                }
+                auto const& sum = sums[root];
+                auto channel = [&](double total) {
+                    return static_cast<uint8_t>(std::clamp<long>(std::lround(total / sum.pixels), 0, 255));
+                };
+                colours[i] = packColour(channel(sum.red), channel(sum.green), channel(sum.blue));
+            }
+            return colours;
+        }
+
+    private:
+        struct MergedRegion {
+            ColourSum sum;
+            LabColour lab{};
+            uint32_t version = 0;
+            // can have old labels and repeats, they are cleaned up when the region is merged
+            std::vector<uint32_t> neighbours;
+        };
+
+        uint32_t find(uint32_t label) {
+            while (m_parents[label] != label) {
+                m_parents[label] = m_parents[m_parents[label]];
+                label = m_parents[label];
+            }
+            return label;
+        }
+
+        void push(uint32_t first, uint32_t second) {
+            auto const& a = m_merged[first];
+            auto const& b = m_merged[second];
+            double distance = labDistance(a.lab, b.lab);
+            double weight = static_cast<double>(a.sum.pixels) * b.sum.pixels / (a.sum.pixels + b.sum.pixels);
+            m_queue.push(MergeCandidate{distance * distance * weight, first, second, a.version, b.version});
+        }
+
+        // cleans every neighbour list and queues each pair that is left once
+        void rebuildQueue() {
+            m_queue = {};
+            for (uint32_t label = 0; label < m_merged.size(); ++label) {
+                if (m_parents[label] != label) {
+                    continue;
+                }
+                auto& neighbours = m_merged[label].neighbours;
+                for (auto& neighbour : neighbours) {
+                    neighbour = find(neighbour);
+                }
+                std::sort(neighbours.begin(), neighbours.end());
+                neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+                neighbours.erase(std::remove(neighbours.begin(), neighbours.end(), label), neighbours.end());
+                for (uint32_t neighbour : neighbours) {
+                    if (label < neighbour) {
+                        push(label, neighbour);
+                    }
+                }
+            }
+        }
+
+        void merge(uint32_t first, uint32_t second) {
+            // the one with more neighbours is kept so less has to be copied
+            if (m_merged[first].neighbours.size() < m_merged[second].neighbours.size()) {
+                std::swap(first, second);
+            }
+            auto& kept = m_merged[first];
+            auto& gone = m_merged[second];
+            m_parents[second] = first;
+            m_merges.emplace_back(first, second);
+            kept.sum.add(gone.sum);
+            auto const& sum = kept.sum;
+            kept.lab = rgbToLab(sum.red / sum.pixels, sum.green / sum.pixels, sum.blue / sum.pixels);
+            kept.version++;
+            gone.version++;
+            // neighbours of both are marked as they are kept so repeats are skipped without sorting
+            m_stamp++;
+            m_seen[first] = m_stamp;
+            size_t keptCount = 0;
+            auto keep = [&](uint32_t neighbour) {
+                neighbour = find(neighbour);
+                if (m_seen[neighbour] != m_stamp) {
+                    m_seen[neighbour] = m_stamp;
+                    kept.neighbours[keptCount++] = neighbour;
+                }
+            };
+            kept.neighbours.insert(kept.neighbours.end(), gone.neighbours.begin(), gone.neighbours.end());
+            gone.neighbours = {};
+            // the list is written over as it is read, which is fine since it only ever shrinks
+            for (size_t i = 0; i < kept.neighbours.size(); ++i) {
+                keep(kept.neighbours[i]);
+            }
+            kept.neighbours.resize(keptCount);
+            for (uint32_t neighbour : kept.neighbours) {
+                push(std::min(first, neighbour), std::max(first, neighbour));
+            }
+            m_active--;
+        }
+
+        std::vector<uint32_t> m_parents;
+        std::vector<MergedRegion> m_merged;
+        // what every region started as and the merges in the order they were made, kept first
+        std::vector<ColourSum> m_initial;
+        std::vector<std::pair<uint32_t, uint32_t>> m_merges;
+        size_t m_active;
+        // which regions were already seen by the merge going on now
+        std::vector<uint32_t> m_seen;
+        uint32_t m_stamp = 0;
+        std::priority_queue<MergeCandidate, std::vector<MergeCandidate>, std::greater<MergeCandidate>> m_queue;
+    };
+
+    size_t countRecords(Generator<ObjectRecord> records) {
+        size_t count = 0;
+        for (auto const& record : records) {
+            (void)record;
+            count++;
+        }
+        return count;
+    }
+}
+
+Generator<ObjectRecord> fitting::fitBudget(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena& arena) {
+    size_t budget = settings.objectBudget;
+    FitReport countReport;
+    size_t count = budget > 0 ? countRecords(fitRectangles(image, settings, countReport, arena)) : 0;
+    // already fits so nothing needs to change
+    if (budget == 0 || count <= budget || countReport.pastDeadline) {
+        for (auto const& record : fitRectangles(image, settings, report, arena)) {
+            co_yield record;
+        }
+        co_return;
+    }
+
+    RegionLabels labels(image, arena);
+    // one region has nothing to merge with, so it goes in as it is
+    if (labels.regions().size() <= 1) {
+        report.overBudget = true;
+        for (auto const& record : fitRectangles(image, settings, report, arena)) {
+            co_yield record;
+        }
+        co_return;
+    }
+    RegionMerger merger(image, labels);
+    size_t imageBytes = static_cast<size_t>(image.width) * image.height * image.channels;
+    ArenaVector<unsigned char> recoloured(imageBytes, 0, ArenaAllocator<unsigned char>(arena));
+    std::memcpy(recoloured.data(), image.data, imageBytes);
+    ImageView view{recoloured.data(), image.width, image.height, image.channels};
+    // paints every region its merged colour and counts the rectangles that makes
+    auto recolour = [&](std::vector<uint32_t> const& colours) {
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                uint32_t label = labels.label(x, y);
+                if (label == RegionLabels::noRegion) {
+                    continue;
+                }
+                auto* pixel = recoloured.data() + (static_cast<size_t>(y) * image.width + x) * image.channels;
+                pixel[0] = colourRed(colours[label]);
+                pixel[1] = colourGreen(colours[label]);
+                pixel[2] = colourBlue(colours[label]);
+            }
+        }
+    };
+    bool pastDeadline = false;
+    auto countPass = [&](std::vector<uint32_t> const& colours) {
+        recolour(colours);
+        FitReport passReport;
+        size_t objects = countRecords(fitRectangles(view, settings, passReport, arena));
+        pastDeadline = passReport.pastDeadline;
+        return objects;
+    };
+
+    std::vector<uint32_t> colours;
+    // merged regions get ragged so objects go down slower than the regions do, each pass guesses
+    // how fast from the last two passes and goes halfway to the budget in log terms, but never
+    // to less than a quarter of the regions as the guess falls apart near the end
+    // the region count from before each pass is kept to go back to
+    size_t overBudget = merger.regionCount();
+    double lastRegions = static_cast<double>(merger.regionCount());
+    double lastCount = static_cast<double>(count);
+    double exponent = 0.5;
+    while (true) {
+        size_t regions = merger.regionCount();
+        double share = std::pow(static_cast<double>(budget) / count, exponent);
+        size_t target = std::max<size_t>(regions / maxShrinkPerPass, static_cast<size_t>(regions * share));
+        target = std::clamp<size_t>(target, 1, regions - 1);
+        overBudget = regions;
+        bool canMergeMore = merger.mergeDownTo(target, settings);
+        colours = merger.regionColours(merger.regionCount());
+        count = countPass(colours);
+        if (count <= budget || !canMergeMore || merger.regionCount() <= 1 || pastDeadline) {
+            break;
+        }
+        // objects went as regions to this power, kept in a sane range for when a pass barely moved
+        double regionsNow = static_cast<double>(merger.regionCount());
+        if (count < lastCount && regionsNow < lastRegions) {
+            double power = std::log(count / lastCount) / std::log(regionsNow / lastRegions);
+            exponent = std::clamp(0.5 / std::max(power, 1e-3), 0.25, 8.0);
+        }
+        lastRegions = regionsNow;
+        lastCount = static_cast<double>(count);
+    }
+
+    // the pass that fit can have gone well past the budget, so it halves the gap to the pass
+    // before until it finds about the fewest merges that still fit, which keeps the most colour
+    if (count <= budget && !pastDeadline) {
+        size_t fits = merger.regionCount();
+        while (overBudget - fits > std::max<size_t>(1, overBudget / bisectPrecision)) {
+            size_t middle = fits + (overBudget - fits) / 2;
+            auto trialColours = merger.regionColours(middle);
+            size_t trialCount = countPass(trialColours);
+            // out of time, the last one that fit is good enough
+            if (pastDeadline) {
+                break;
+            }
+            if (trialCount <= budget) {
+                fits = middle;
+                count = trialCount;
+                colours = std::move(trialColours);
+            }
+            else {
+                overBudget = middle;
+            }
+        }
+        recolour(colours);
+    }
+
+    // every pixel of an original region moved by the same amount
+    auto const& regions = labels.regions();
+    for (size_t i = 0; i < regions.size(); ++i) {
+        auto before = rgbToLab(colourRed(regions[i].colour), colourGreen(regions[i].colour),
+            colourBlue(regions[i].colour));
+        auto after = rgbToLab(colourRed(colours[i]), colourGreen(colours[i]), colourBlue(colours[i]));
+        report.colourError += labDistance(before, after) * regions[i].pixels;
+        report.colourPixels += regions[i].pixels;
+    }
+    report.coloursMerged = true;
+    report.overBudget = count > budget;
+    for (auto const& record : fitRectangles(view, settings, report, arena)) {
+        co_yield record;
+    }
+}
@@ -0,0 +1,145 @@
+#include "Colour.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include "ImportTrace.hpp"
+#include "ThreadPool.hpp"
+
+void rgbToHsv(int red, int green, int blue, float& h, float& s, float& v) {
+    // normalize the rgb values
+    float r = red / 255.0f;
+    float g = green / 255.0f;
+    float b = blue / 255.0f;
+    // find the maximum and minimum
+    float maxColour = std::max(r, std::max(g, b));
+    float minColour = std::min(r, std::min(g, b));
+    // max colour value
+    v = maxColour;
+    // difference between the max and min
+    float delta = maxColour - minColour;
+    // if the difference is less than a small threshold, the colour is grey
+    if (delta < 0.00001f) {
+        s = 0;
+        h = 0;
+        return;
+    }
+    // the difference between the max and min
+    // colour values divided by the max colour
+    if (maxColour > 0.0) {
+        s = (delta / maxColour);
+    } else {
+        // max colour is 0, the colour is black, so saturation is 0, hue is undefined
+        s = 0.0;
+        h = std::numeric_limits<float>::quiet_NaN();
+        return;
+    }
+    // calculate hue
+    if (r >= maxColour)
+        h = (g - b) / delta;
+    else if (g >= maxColour)
+        h = 2.0f + (b - r) / delta;
+    else
+        h = 4.0f + (r - g) / delta;
+    // convert hue to degrees
+    h *= 60.0f;
+    if (h < 0.0f)
+        // stop it being negative
+        h += 360.0f;
+    // converts colours to the gd format of -180 to 180
+    h = fmodf(h + 180.0f, 360.0f) - 180.0f;
+}
+
+void hsvToRgb(float h, float s, float v, int& red, int& green, int& blue) {
+    // back to 0 to 360 and then which sixth of the colour wheel it is in
+    float hue = std::fmod(h, 360.0f);
+    if (hue < 0) {
+        hue += 360.0f;
+    }
+    float sector = hue / 60.0f;
+    int index = static_cast<int>(sector) % 6;
+    float fraction = sector - std::floor(sector);
+    float p = v * (1 - s);
+    float q = v * (1 - s * fraction);
+    float t = v * (1 - s * (1 - fraction));
+    float r;
+    float g;
+    float b;
+    switch (index) {
+        case 0: r = v; g = t; b = p; break;
+        case 1: r = q; g = v; b = p; break;
+        case 2: r = p; g = v; b = t; break;
+        case 3: r = p; g = q; b = v; break;
+        case 4: r = t; g = p; b = v; break;
+        default: r = v; g = p; b = q; break;
+    }
+    auto toByte = [](float value) {
+        return std::clamp(static_cast<int>(std::lround(value * 255.0f)), 0, 255);
+    };
+    red = toByte(r);
+    green = toByte(g);
+    blue = toByte(b);
+}
+
+LabColour rgbToLab(double red, double green, double blue) {
+    // srgb to linear light
+    auto linear = [](double value) {
+        value /= 255.0;
+        return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+    };
+    double r = linear(red);
+    double g = linear(green);
+    double b = linear(blue);
+    // linear rgb to xyz, divided by the d65 white point
+    double x = (0.4124 * r + 0.3576 * g + 0.1805 * b) / 0.95047;
+    double y = 0.2126 * r + 0.7152 * g + 0.0722 * b;
+    double z = (0.0193 * r + 0.1192 * g + 0.9505 * b) / 1.08883;
+    auto curve = [](double value) {
+        return value > 0.008856 ? std::cbrt(value) : 7.787 * value + 16.0 / 116.0;
+    };
+    double fx = curve(x);
+    double fy = curve(y);
+    double fz = curve(z);
+    return LabColour{static_cast<float>(116 * fy - 16), static_cast<float>(500 * (fx - fy)),
+        static_cast<float>(200 * (fy - fz))};
+}
+
+float labDistance(LabColour const& first, LabColour const& second) {
+    float l = first.l - second.l;
+    float a = first.a - second.a;
+    float b = first.b - second.b;
+    return std::sqrt(l * l + a * a + b * b);
+}
+
+size_t formatHsv(char* buffer, int red, int green, int blue) {
+    float h;
+    float s;
+    float v;
+    rgbToHsv(red, green, blue, h, s, v);
+    if(h == 0){
+        h+=1;
+    }
+    // same as joining std::to_string of each value
+    int length = std::snprintf(buffer, maxHsvStringLength, "%fa%fa%fa1a1", h, s, v);
+    return static_cast<size_t>(std::max(length, 0));
+}
+
+std::string formatHsvToString(int red, int green, int blue) {
+    char buffer[maxHsvStringLength];
+    size_t length = formatHsv(buffer, red, green, blue);
+    // returns the formated data
+    return std::string(buffer, length);
+}
+
+ColourPalette::ColourPalette(std::span<const uint32_t> colours, ThreadPool& pool, ImportArena& arena)
+    : m_text(colours.size() * maxHsvStringLength, '\0', ArenaAllocator<char>(arena)),
+    m_lengths(colours.size(), 0, ArenaAllocator<uint8_t>(arena)) {
+    TraceSpan span("colour palette", "serialize", {"colours", static_cast<int64_t>(colours.size())});
+    // converts the colours to the gd format on the pool
+    pool.parallelFor(0, colours.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            m_lengths[i] = static_cast<uint8_t>(formatHsv(m_text.data() + i * maxHsvStringLength,
+                colourRed(colours[i]), colourGreen(colours[i]), colourBlue(colours[i])));
+        }
+    });
+}
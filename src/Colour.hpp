@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include "ImageView.hpp"
+#include "ImportArena.hpp"
+
+class ThreadPool;
+
+// packs a colour into one number so it can be used as a key
+inline uint32_t packColour(uint8_t red, uint8_t green, uint8_t blue) {
+    return (static_cast<uint32_t>(red) << 16) | (static_cast<uint32_t>(green) << 8) | blue;
+}
+
+inline uint8_t colourRed(uint32_t colour) { return (colour >> 16) & 0xff; }
+inline uint8_t colourGreen(uint32_t colour) { return (colour >> 8) & 0xff; }
+inline uint8_t colourBlue(uint32_t colour) { return colour & 0xff; }
+
+// converts the rgb values to hsv
+void rgbToHsv(int red, int green, int blue, float& h, float& s, float& v);
+
+// turns the hsv from a level string back into rgb, hue is in the gd range of -180 to 180
+void hsvToRgb(float h, float s, float v, int& red, int& green, int& blue);
+
+// cie lab, the distance between two of these is roughly how different they look
+struct LabColour {
+    float l;
+    float a;
+    float b;
+};
+
+// takes 0 to 255 values, they can have fractions so averages work too
+LabColour rgbToLab(double red, double green, double blue);
+
+// cie76 delta e, about 2.3 is the smallest difference people notice
+float labDistance(LabColour const& first, LabColour const& second);
+
+// longest string formatHsv can write, including the null
+constexpr size_t maxHsvStringLength = 48;
+
+// writes hsv in the format gd uses for key 43 into the buffer
+// and returns the length, the buffer needs maxHsvStringLength chars
+size_t formatHsv(char* buffer, int red, int green, int blue);
+
+// makes hsv a string in the format gd uses for key 43
+std::string formatHsvToString(int red, int green, int blue);
+
+// a table of colours converted to the gd format once each
+class ColourPalette {
+public:
+    // converts the packed rgb colours on the pool, the strings keep the same indices
+    ColourPalette(std::span<const uint32_t> colours, ThreadPool& pool, ImportArena& arena);
+
+    // the gd string for the colour at an index
+    std::string_view format(size_t index) const {
+        return {m_text.data() + index * maxHsvStringLength, m_lengths[index]};
+    }
+
+    size_t size() const { return m_lengths.size(); }
+
+private:
+    // every string gets a fixed slot so they can be written in parallel
+    ArenaVector<char> m_text;
+    ArenaVector<uint8_t> m_lengths;
+};
@@ -0,0 +1,132 @@
+#include "CoverageVerifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include "LevelString.hpp"
+#include "ObjectStore.hpp"
+
+using namespace objects;
+
+namespace {
+    // positions come out of float maths so they only have to be this close to a pixel
+    constexpr double alignmentTolerance = 1e-3;
+
+    bool knownObject(int objectID) {
+        return objectID == pixelObjID || objectID == medPixelObjID || objectID == bigPixelObjID ||
+            objectID == largePixelObjID || objectID == oldPixelObjID;
+    }
+
+    // rounds to the nearest whole pixel, failing if it is not close to one
+    bool toPixel(double value, int& pixel) {
+        double rounded = std::round(value);
+        if (std::fabs(value - rounded) > alignmentTolerance) {
+            return false;
+        }
+        pixel = static_cast<int>(rounded);
+        return true;
+    }
+}
+
+char const* coverageIssueName(CoverageIssue::Kind kind) {
+    switch (kind) {
+        case CoverageIssue::Kind::Uncovered: return "uncovered";
+        case CoverageIssue::Kind::DoubleCovered: return "covered twice";
+        case CoverageIssue::Kind::WrongColour: return "wrong colour";
+        case CoverageIssue::Kind::OutsideArt: return "outside the art";
+        case CoverageIssue::Kind::Misplaced: return "misplaced object";
+    }
+    return "unknown";
+}
+
+std::string CoverageReport::describe() const {
+    std::string text = fmt::format("{} pixels uncovered, {} covered twice, {} the wrong colour, "
+        "{} outside the art, {} misplaced objects", uncovered, doubleCovered, wrongColour, outsideArt, misplaced);
+    if (!issues.empty()) {
+        text += fmt::format(", first {} at {},{}", coverageIssueName(issues[0].kind), issues[0].x, issues[0].y);
+    }
+    return text;
+}
+
+CoverageReport verifyCoverage(ImageView image, ObjectStore const& objects, VerifyOptions const& options) {
+    CoverageReport report;
+    report.overlapAllowed = options.allowOverlap;
+    report.recolourAllowed = options.allowRecolour;
+    auto addIssue = [&](CoverageIssue::Kind kind, int x, int y) {
+        if (report.issues.size() < options.maxIssues) {
+            report.issues.push_back(CoverageIssue{kind, x, y});
+        }
+    };
+    // only the highest layer over a pixel shows, so that is the one checked
+    struct PixelCover {
+        int16_t layer = -1;
+        // how many objects on that layer cover it, stops counting at 2
+        uint8_t count = 0;
+        bool wrongColour = false;
+    };
+    std::vector<PixelCover> covers(static_cast<size_t>(image.width) * image.height);
+    for (size_t i = 0; i < objects.size(); ++i) {
+        auto record = objects.record(i);
+        if (!knownObject(record.objectID)) {
+            report.misplaced++;
+            addIssue(CoverageIssue::Kind::Misplaced, record.x, record.y);
+            continue;
+        }
+        // goes from the centre and scale back to pixels, y goes up in the level and down in the image
+        auto placement = placeObject(record, ArtOrigin{0, 0});
+        double spacing = pixelSpacing(record.objectID);
+        double size = unscaledSize(record.objectID);
+        int columns;
+        int rows;
+        int left;
+        int top;
+        if (!toPixel(size * placement.scaleX / spacing, columns) ||
+            !toPixel(size * placement.scaleY / spacing, rows) || columns < 1 || rows < 1 ||
+            !toPixel(placement.x / spacing - (columns - 1) * 0.5, left) ||
+            !toPixel(-placement.y / spacing - (rows - 1) * 0.5, top)) {
+            report.misplaced++;
+            addIssue(CoverageIssue::Kind::Misplaced, record.x, record.y);
+            continue;
+        }
+        for (int y = top; y < top + rows; ++y) {
+            for (int x = left; x < left + columns; ++x) {
+                if (x < 0 || y < 0 || x >= image.width || y >= image.height || !image.isOpaque(x, y)) {
+                    report.outsideArt++;
+                    addIssue(CoverageIssue::Kind::OutsideArt, x, y);
+                    continue;
+                }
+                auto& cover = covers[static_cast<size_t>(y) * image.width + x];
+                bool wrongColour = image.colour(x, y) != record.colour;
+                if (record.layer > cover.layer) {
+                    cover = PixelCover{static_cast<int16_t>(record.layer), 1, wrongColour};
+                }
+                else if (record.layer == cover.layer) {
+                    cover.count = static_cast<uint8_t>(std::min(cover.count + 1, 2));
+                    cover.wrongColour = cover.wrongColour || wrongColour;
+                }
+            }
+        }
+    }
+    for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+            auto const& cover = covers[static_cast<size_t>(y) * image.width + x];
+            if (cover.wrongColour) {
+                report.wrongColour++;
+                if (!options.allowRecolour) {
+                    addIssue(CoverageIssue::Kind::WrongColour, x, y);
+                }
+            }
+            if (cover.count == 2) {
+                report.doubleCovered++;
+                // overlaps that are allowed are not worth pointing at
+                if (!options.allowOverlap) {
+                    addIssue(CoverageIssue::Kind::DoubleCovered, x, y);
+                }
+            }
+            else if (cover.count == 0 && image.isOpaque(x, y)) {
+                report.uncovered++;
+                addIssue(CoverageIssue::Kind::Uncovered, x, y);
+            }
+        }
+    }
+    return report;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ImageView.hpp"
+
+class ObjectStore;
+
+struct CoverageIssue {
+    enum class Kind {
+        // an opaque pixel no object covers
+        Uncovered,
+        // a pixel more than one object on its top layer covers
+        DoubleCovered,
+        // the top object over a pixel is another colour, lower ones can be anything
+        WrongColour,
+        // an object covers a transparent pixel or goes past the edge
+        OutsideArt,
+        // an object with an unknown ID or that does not line up with the pixels
+        Misplaced,
+    };
+
+    Kind kind;
+    int x;
+    int y;
+};
+
+struct VerifyOptions {
+    // squares can overlap squares of the same colour as it looks the same
+    bool allowOverlap = false;
+    // modes that change colours on purpose only have to cover the right pixels
+    bool allowRecolour = false;
+    // how many issues are kept with their position
+    size_t maxIssues = 16;
+};
+
+struct CoverageReport {
+    size_t uncovered = 0;
+    size_t doubleCovered = 0;
+    size_t wrongColour = 0;
+    size_t outsideArt = 0;
+    size_t misplaced = 0;
+    bool overlapAllowed = false;
+    bool recolourAllowed = false;
+    // the first few issues found, to know where to look
+    std::vector<CoverageIssue> issues;
+
+    bool passed() const {
+        return uncovered == 0 && (recolourAllowed || wrongColour == 0) && outsideArt == 0 && misplaced == 0 &&
+            (overlapAllowed || doubleCovered == 0);
+    }
+    size_t problemCount() const {
+        return uncovered + (recolourAllowed ? 0 : wrongColour) + outsideArt + misplaced +
+            (overlapAllowed ? 0 : doubleCovered);
+    }
+    // one line saying what is wrong and where
+    std::string describe() const;
+};
+
+char const* coverageIssueName(CoverageIssue::Kind kind);
+
+// works out which pixels each object covers from the position and scale it
+// gets in the level string, the same way the game places it, and checks
+// that against the image
+CoverageReport verifyCoverage(ImageView image, ObjectStore const& objects, VerifyOptions const& options = {});
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include "ArtFitter.hpp"
+#include "PixelMask.hpp"
+
+// the fitting strategies fitArt picks from, each one yields records
+// bottom row first like the original loop so they can share the fallback
+namespace fitting {
+    Generator<ObjectRecord> fitSquares(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+    Generator<ObjectRecord> fitRectangles(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+    Generator<ObjectRecord> fitPartition(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+    Generator<ObjectRecord> fitRuns(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+    Generator<ObjectRecord> fitLayered(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+    Generator<ObjectRecord> fitQuadtree(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+    Generator<ObjectRecord> fitBudget(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+    // fits bands of the image in the mode in the settings and joins them, see parallelTiles
+    Generator<ObjectRecord> fitTiles(ImageView image, FitSettings settings, FitReport& report,
+        ImportArena& arena);
+
+    // checks if a pixel is opaque, not placed yet and the same colour as the target
+    inline bool canTake(ImageView const& image, PixelMask const& placed, int x, int y, int targetX, int targetY) {
+        return !placed.test(x, y) && image.isOpaque(x, y) && image.sameColour(x, y, targetX, targetY);
+    }
+
+    // checked at the start of each row, once it passes the rest is done as plain rows
+    inline bool passedDeadline(FitSettings const& settings, FitReport& report, int y) {
+        if (!report.pastDeadline && settings.outOfTime()) {
+            report.pastDeadline = true;
+            report.fallbackRows = y + 1;
+        }
+        return report.pastDeadline;
+    }
+
+    // stretches a pixel along its row over every pixel of the same colour
+    inline ObjectRecord takeRow(ImageView const& image, PixelMask& placed, int x, int y) {
+        ObjectRecord record{objects::pixelObjID, x, y, 1, 1, image.colour(x, y)};
+        placed.set(x, y);
+        while (x + record.width < image.width && canTake(image, placed, x + record.width, y, x, y)) {
+            placed.set(x + record.width, y);
+            record.width++;
+        }
+        return record;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+// lazy coroutine generator, nothing runs until the next value is asked for
+// so whoever is reading it decides the pace and can stop whenever they want
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T next) {
+            value = std::move(next);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    struct Sentinel {};
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        explicit Iterator(Handle handle) : m_handle(handle) {}
+
+        T& operator*() const { return *m_handle.promise().value; }
+        T* operator->() const { return &*m_handle.promise().value; }
+        Iterator& operator++() {
+            resume(m_handle);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+        bool operator==(Sentinel) const { return !m_handle || m_handle.done(); }
+
+    private:
+        Handle m_handle;
+    };
+
+    Generator() = default;
+    explicit Generator(Handle handle) : m_handle(handle) {}
+    Generator(Generator&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            reset();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    // stopping early just throws away the paused coroutine
+    ~Generator() { reset(); }
+
+    // runs the coroutine up to its first value
+    Iterator begin() {
+        if (m_handle) {
+            resume(m_handle);
+        }
+        return Iterator(m_handle);
+    }
+    Sentinel end() { return {}; }
+
+    // gets the next value or nothing once the coroutine has finished
+    std::optional<T> next() {
+        if (!m_handle || m_handle.done()) {
+            return std::nullopt;
+        }
+        resume(m_handle);
+        if (m_handle.done()) {
+            return std::nullopt;
+        }
+        return std::move(m_handle.promise().value);
+    }
+
+private:
+    static void resume(Handle handle) {
+        handle.promise().value.reset();
+        handle.resume();
+        // passes exceptions on to whoever is reading
+        if (handle.promise().error) {
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+        }
+    }
+
+    void reset() {
+        if (m_handle) {
+            m_handle.destroy();
+            m_handle = {};
+        }
+    }
+
+    Handle m_handle;
+};
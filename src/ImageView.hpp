@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// read only view of decoded image data, rows go top to bottom
+struct ImageView {
+    const unsigned char* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    const unsigned char* pixel(int x, int y) const {
+        return data + (static_cast<long long>(y) * width + x) * channels;
+    }
+
+    // images without an alpha channel count as fully opaque
+    bool isOpaque(int x, int y) const {
+        return channels != 4 || pixel(x, y)[3] != 0;
+    }
+
+    // compares the rgb of two pixels
+    bool sameColour(int x, int y, int otherX, int otherY) const {
+        auto* first = pixel(x, y);
+        auto* second = pixel(otherX, otherY);
+        return first[0] == second[0] && first[1] == second[1] && first[2] == second[2];
+    }
+
+    // rgb of a pixel packed into one number
+    uint32_t colour(int x, int y) const {
+        auto* p = pixel(x, y);
+        return (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+    }
+};
@@ -0,0 +1,74 @@
+#include "ImportArena.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    // blocks double in size so big imports only need a few of them
+    constexpr size_t maxGrowthBlockSize = 64 * 1024 * 1024;
+}
+
+ImportArena::ImportArena(size_t firstBlockSize) : m_nextBlockSize(std::max<size_t>(firstBlockSize, 1024)) {}
+
+ImportArena::~ImportArena() {
+    while (m_blocks) {
+        Block* next = m_blocks->next;
+        std::free(m_blocks);
+        m_blocks = next;
+    }
+}
+
+void ImportArena::addBlock(size_t minimumBytes) {
+    // anything too big for the normal block gets a block of its own
+    size_t size = std::max(m_nextBlockSize, minimumBytes + sizeof(Block) + alignof(std::max_align_t));
+    auto* block = static_cast<Block*>(std::malloc(size));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    block->next = m_blocks;
+    block->size = size;
+    m_blocks = block;
+    m_cursor = reinterpret_cast<char*>(block) + sizeof(Block);
+    m_end = reinterpret_cast<char*>(block) + size;
+    m_nextBlockSize = std::min(m_nextBlockSize * 2, maxGrowthBlockSize);
+    m_blockCount++;
+    m_reservedBytes += size;
+}
+
+void* ImportArena::allocate(size_t bytes, size_t alignment) {
+    std::lock_guard lock(m_mutex);
+    auto aligned = [&] {
+        auto address = reinterpret_cast<uintptr_t>(m_cursor);
+        return reinterpret_cast<char*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    };
+    char* start = m_cursor ? aligned() : nullptr;
+    if (!start || start + bytes > m_end) {
+        addBlock(bytes + alignment);
+        start = aligned();
+    }
+    m_cursor = start + bytes;
+    m_allocationCount++;
+    m_allocatedBytes += bytes;
+    return start;
+}
+
+size_t ImportArena::blockCount() const {
+    std::lock_guard lock(m_mutex);
+    return m_blockCount;
+}
+
+size_t ImportArena::reservedBytes() const {
+    std::lock_guard lock(m_mutex);
+    return m_reservedBytes;
+}
+
+size_t ImportArena::allocationCount() const {
+    std::lock_guard lock(m_mutex);
+    return m_allocationCount;
+}
+
+size_t ImportArena::allocatedBytes() const {
+    std::lock_guard lock(m_mutex);
+    return m_allocatedBytes;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// monotonic memory for everything one import needs temporarily
+// memory is handed out from big blocks and never given back one piece
+// at a time, the whole thing is freed at once when the arena is destroyed
+class ImportArena {
+public:
+    explicit ImportArena(size_t firstBlockSize = 64 * 1024);
+    ~ImportArena();
+
+    ImportArena(const ImportArena&) = delete;
+    ImportArena& operator=(const ImportArena&) = delete;
+
+    // safe to call from the thread pool
+    void* allocate(size_t bytes, size_t alignment);
+
+    // how many times the arena went to the heap
+    size_t blockCount() const;
+    // total size of the blocks taken from the heap
+    size_t reservedBytes() const;
+    // how many allocations were handed out and how many bytes they asked for
+    size_t allocationCount() const;
+    size_t allocatedBytes() const;
+
+private:
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    void addBlock(size_t minimumBytes);
+
+    mutable std::mutex m_mutex;
+    Block* m_blocks = nullptr;
+    char* m_cursor = nullptr;
+    char* m_end = nullptr;
+    size_t m_nextBlockSize;
+    size_t m_blockCount = 0;
+    size_t m_reservedBytes = 0;
+    size_t m_allocationCount = 0;
+    size_t m_allocatedBytes = 0;
+};
+
+// lets standard containers use an import arena, freeing does nothing
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(ImportArena& arena) : m_arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(ArenaAllocator<U> const& other) : m_arena(other.arena()) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) {}
+
+    ImportArena* arena() const { return m_arena; }
+
+    template <typename U>
+    bool operator==(ArenaAllocator<U> const& other) const { return m_arena == other.arena(); }
+
+private:
+    ImportArena* m_arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+template <typename Key, typename Value>
+using ArenaMap = std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>,
+    ArenaAllocator<std::pair<const Key, Value>>>;
@@ -0,0 +1,132 @@
+#include "ImportStats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fmt/format.h>
+#include "ImportArena.hpp"
+#include "MemoryBudget.hpp"
+#include "ObjectStore.hpp"
+
+using namespace objects;
+
+namespace {
+    // allocations made through the counted allocators
+    std::atomic<size_t> s_countedAllocations{0};
+    std::atomic<size_t> s_countedBytes{0};
+
+    double toMegabytes(size_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    std::string stageMemoryText(char const* name, StageMemory const& memory) {
+        return fmt::format(" {}_allocs={} {}_alloc_bytes={} {}_rss={}", name, memory.allocations, name,
+            memory.allocatedBytes, name, memory.residentBytes);
+    }
+}
+
+void* countedMalloc(size_t bytes) {
+    s_countedAllocations++;
+    s_countedBytes += bytes;
+    return std::malloc(bytes);
+}
+
+void* countedRealloc(void* pointer, size_t bytes) {
+    s_countedAllocations++;
+    s_countedBytes += bytes;
+    return std::realloc(pointer, bytes);
+}
+
+StageMemory countedAllocations() {
+    StageMemory memory;
+    memory.allocations = s_countedAllocations;
+    memory.allocatedBytes = s_countedBytes;
+    return memory;
+}
+
+StageMemoryMeter::StageMemoryMeter(StageMemory& memory, ImportArena const* arena)
+    : m_memory(memory), m_arena(arena),
+    m_startAllocations(s_countedAllocations + (arena ? arena->allocationCount() : 0)),
+    m_startBytes(s_countedBytes + (arena ? arena->allocatedBytes() : 0)) {}
+
+StageMemoryMeter::~StageMemoryMeter() {
+    size_t allocations = s_countedAllocations + (m_arena ? m_arena->allocationCount() : 0);
+    size_t bytes = s_countedBytes + (m_arena ? m_arena->allocatedBytes() : 0);
+    m_memory.allocations += allocations - m_startAllocations;
+    m_memory.allocatedBytes += bytes - m_startBytes;
+    auto resident = residentMemory();
+    m_memory.residentBytes = std::max(m_memory.residentBytes, resident.current);
+    m_memory.peakResidentBytes = std::max(m_memory.peakResidentBytes, resident.peak);
+}
+
+size_t ImportStats::peakResidentBytes() const {
+    return std::max({decodeMemory.peakResidentBytes, spillMemory.peakResidentBytes,
+        fittingMemory.peakResidentBytes, serializeMemory.peakResidentBytes, insertMemory.peakResidentBytes});
+}
+
+void ImportStats::countObjects(ObjectStore const& objects) {
+    auto ids = objects.ids();
+    auto widths = objects.widths();
+    auto heights = objects.heights();
+    for (size_t i = 0; i < ids.size(); ++i) {
+        int side = 1;
+        switch (ids[i]) {
+            case largePixelObjID: side = 6; break;
+            case bigPixelObjID: side = 3; break;
+            case medPixelObjID: side = 2; break;
+            default: break;
+        }
+        // the rectangle modes and scaling stretch the objects over more pixels than their square
+        if (widths[i] != side || heights[i] != side) {
+            stretchedObjects++;
+            continue;
+        }
+        switch (side) {
+            case 6: largeObjects++; break;
+            case 3: bigObjects++; break;
+            case 2: medObjects++; break;
+            default: pixelObjects++; break;
+        }
+    }
+}
+
+std::string ImportStats::popupText() const {
+    return fmt::format(
+        "<cy>{}</c> objects: {} large, {} big, {} medium, {} 1x1, {} stretched\n"
+        "{} pixels, {} colours, {} KB of objects\n"
+        "Took {:.0f} ms: decode {:.0f}, fit {:.0f}, write {:.0f}, insert {:.0f}\n"
+        "Memory: image {:.1f} MB, placed grid {:.1f} MB, objects {:.1f} MB, text {:.1f} MB{}",
+        objects(), largeObjects, bigObjects, medObjects, pixelObjects, stretchedObjects,
+        pixels, uniqueColours, bytesEmitted / 1024,
+        totalSeconds() * 1000, (decodeSeconds + spillSeconds) * 1000, fittingSeconds * 1000,
+        serializeSeconds * 1000, insertSeconds * 1000,
+        toMegabytes(imageBytes), toMegabytes(placedBytes), toMegabytes(objectStoreBytes), toMegabytes(stringBytes),
+        peakResidentBytes() ? fmt::format(", game peak {:.0f} MB", toMegabytes(peakResidentBytes())) : "");
+}
+
+std::string ImportStats::logText() const {
+    return fmt::format(
+        "objects={} large={} big={} med={} pixel={} stretched={} pixels={} colours={} bytes={} "
+        "decode={:.2f}ms spill={:.2f}ms fit={:.2f}ms write={:.2f}ms insert={:.2f}ms total={:.2f}ms",
+        objects(), largeObjects, bigObjects, medObjects, pixelObjects, stretchedObjects, pixels, uniqueColours,
+        bytesEmitted,
+        decodeSeconds * 1000, spillSeconds * 1000, fittingSeconds * 1000, serializeSeconds * 1000,
+        insertSeconds * 1000, totalSeconds() * 1000) +
+        fmt::format(" image_bytes={} placed_bytes={} store_bytes={} string_bytes={} peak_rss={}", imageBytes,
+        placedBytes, objectStoreBytes, stringBytes, peakResidentBytes()) +
+        stageMemoryText("decode", decodeMemory) + stageMemoryText("spill", spillMemory) +
+        stageMemoryText("fit", fittingMemory) + stageMemoryText("write", serializeMemory) +
+        stageMemoryText("insert", insertMemory);
+}
+
+size_t countOpaquePixels(ImageView const& image) {
+    if (image.channels != 4) {
+        return static_cast<size_t>(image.width) * image.height;
+    }
+    size_t count = 0;
+    for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+            count += image.isOpaque(x, y);
+        }
+    }
+    return count;
+}
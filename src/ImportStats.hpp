@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include "ImageView.hpp"
+
+class ImportArena;
+class ObjectStore;
+
+// allocations and memory use of one stage
+struct StageMemory {
+    // counted allocations made during the stage, from the arenas and the decoder
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+    // memory the game was using once the stage was done, 0 when it can not be read
+    size_t residentBytes = 0;
+    size_t peakResidentBytes = 0;
+};
+
+// timings and counts for one import
+struct ImportStats {
+    // seconds spent in each stage
+    double decodeSeconds = 0;
+    double spillSeconds = 0;
+    double fittingSeconds = 0;
+    double serializeSeconds = 0;
+    double insertSeconds = 0;
+
+    // opaque pixels in the image
+    size_t pixels = 0;
+    size_t uniqueColours = 0;
+    // objects by the size they cover, the squares and single pixels as they are and anything
+    // scaled past its own square as stretched
+    size_t largeObjects = 0;
+    size_t bigObjects = 0;
+    size_t medObjects = 0;
+    size_t pixelObjects = 0;
+    size_t stretchedObjects = 0;
+    // length of the level strings handed to the game
+    size_t bytesEmitted = 0;
+
+    StageMemory decodeMemory;
+    StageMemory spillMemory;
+    StageMemory fittingMemory;
+    StageMemory serializeMemory;
+    StageMemory insertMemory;
+    // estimated size of the main buffers, the biggest each one got
+    size_t imageBytes = 0;
+    size_t placedBytes = 0;
+    size_t objectStoreBytes = 0;
+    size_t stringBytes = 0;
+
+    size_t objects() const { return largeObjects + bigObjects + medObjects + pixelObjects + stretchedObjects; }
+    double totalSeconds() const {
+        return decodeSeconds + spillSeconds + fittingSeconds + serializeSeconds + insertSeconds;
+    }
+    size_t peakResidentBytes() const;
+
+    // adds up the objects in a store by their object ID and size
+    void countObjects(ObjectStore const& objects);
+
+    // short summary for the success popup
+    std::string popupText() const;
+    // everything on one line for the log
+    std::string logText() const;
+};
+
+// adds the time from when it is made until it is destroyed to a stage
+class StageTimer {
+public:
+    explicit StageTimer(double& seconds) : m_seconds(seconds), m_start(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        m_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    double& m_seconds;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// counts the allocations made while it is alive and reads the memory in use once it is done
+class StageMemoryMeter {
+public:
+    explicit StageMemoryMeter(StageMemory& memory, ImportArena const* arena = nullptr);
+    ~StageMemoryMeter();
+
+    StageMemoryMeter(const StageMemoryMeter&) = delete;
+    StageMemoryMeter& operator=(const StageMemoryMeter&) = delete;
+
+private:
+    StageMemory& m_memory;
+    ImportArena const* m_arena;
+    size_t m_startAllocations;
+    size_t m_startBytes;
+};
+
+// allocators that get counted, the decoder is built with these
+void* countedMalloc(size_t bytes);
+void* countedRealloc(void* pointer, size_t bytes);
+// everything the counted allocators have handed out so far
+StageMemory countedAllocations();
+
+size_t countOpaquePixels(ImageView const& image);
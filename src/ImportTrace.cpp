@@ -0,0 +1,61 @@
+#include "ImportTrace.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+
+ImportTrace::ImportTrace() : m_start(Clock::now()) {
+    m_lanes.push_back(std::this_thread::get_id());
+}
+
+int ImportTrace::laneFor(std::thread::id thread) {
+    auto lane = std::find(m_lanes.begin(), m_lanes.end(), thread);
+    if (lane != m_lanes.end()) {
+        return static_cast<int>(lane - m_lanes.begin());
+    }
+    m_lanes.push_back(thread);
+    return static_cast<int>(m_lanes.size() - 1);
+}
+
+void ImportTrace::addSpan(char const* name, char const* category, Clock::time_point start, Clock::time_point end,
+    TraceArg first, TraceArg second) {
+    auto toNs = [&](Clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_start).count();
+    };
+    std::lock_guard lock(m_mutex);
+    m_spans.push_back(Span{name, category, laneFor(std::this_thread::get_id()), toNs(start),
+        toNs(end) - toNs(start), {first, second}});
+}
+
+size_t ImportTrace::spanCount() const {
+    std::lock_guard lock(m_mutex);
+    return m_spans.size();
+}
+
+std::string ImportTrace::toJson() const {
+    std::lock_guard lock(m_mutex);
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    // names the rows, the viewer sorts them by the sort index
+    for (size_t lane = 0; lane < m_lanes.size(); ++lane) {
+        std::string name = lane == 0 ? "import" : fmt::format("worker {}", lane);
+        json += fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}},\n",
+            lane, name);
+        json += fmt::format("{{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":{},"
+            "\"args\":{{\"sort_index\":{}}}}},\n", lane, lane);
+    }
+    for (auto const& span : m_spans) {
+        // times are in microseconds
+        json += fmt::format("{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+            "\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{", span.name, span.category, span.lane,
+            span.startNs / 1000.0, span.durationNs / 1000.0);
+        bool first = true;
+        for (auto const& arg : span.args) {
+            if (!arg.key) {
+                continue;
+            }
+            json += fmt::format("{}\"{}\":{}", first ? "" : ",", arg.key, arg.value);
+            first = false;
+        }
+        json += "}},\n";
+    }
+    json += fmt::format("{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{{\"name\":\"Art importer\"}}}}\n]}}\n");
+    return json;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// a name and number shown when a span is clicked on
+struct TraceArg {
+    char const* key = nullptr;
+    int64_t value = 0;
+};
+
+// records what every thread did during an import as chrome trace events
+// so the file can be opened in chrome://tracing or ui.perfetto.dev
+class ImportTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ImportTrace();
+
+    ImportTrace(const ImportTrace&) = delete;
+    ImportTrace& operator=(const ImportTrace&) = delete;
+
+    // names and categories have to be string literals, they are not copied
+    void addSpan(char const* name, char const* category, Clock::time_point start, Clock::time_point end,
+        TraceArg first = {}, TraceArg second = {});
+
+    size_t spanCount() const;
+    // the trace event json format
+    std::string toJson() const;
+
+    // spans are recorded to this trace while it is set, nothing is recorded when it is null
+    // or on a thread that opted out
+    static ImportTrace* active() { return t_ignored ? nullptr : s_active.load(std::memory_order_acquire); }
+    static void setActive(ImportTrace* trace) { s_active.store(trace, std::memory_order_release); }
+    // for threads that outlive the import, like the background refiner, so they never
+    // record into a trace that is being written out or already gone
+    static void ignoreThisThread() { t_ignored = true; }
+
+private:
+    struct Span {
+        char const* name;
+        char const* category;
+        int lane;
+        int64_t startNs;
+        int64_t durationNs;
+        TraceArg args[2];
+    };
+
+    // gives each thread its own row in the viewer, the importing thread is row 0
+    int laneFor(std::thread::id thread);
+
+    mutable std::mutex m_mutex;
+    Clock::time_point m_start;
+    std::vector<std::thread::id> m_lanes;
+    std::vector<Span> m_spans;
+
+    static inline std::atomic<ImportTrace*> s_active{nullptr};
+    static inline thread_local bool t_ignored = false;
+};
+
+// records a span from when it is made until it is destroyed, costs a flag check and one atomic load
+// when tracing is off
+class TraceSpan {
+public:
+    TraceSpan(char const* name, char const* category, TraceArg first = {}, TraceArg second = {})
+        : m_trace(ImportTrace::active()), m_name(name), m_category(category), m_first(first), m_second(second) {
+        if (m_trace) {
+            m_start = ImportTrace::Clock::now();
+        }
+    }
+    ~TraceSpan() {
+        if (m_trace) {
+            m_trace->addSpan(m_name, m_category, m_start, ImportTrace::Clock::now(), m_first, m_second);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // for numbers only known once the work is done
+    void setArg(int index, char const* key, int64_t value) {
+        (index == 0 ? m_first : m_second) = TraceArg{key, value};
+    }
+
+private:
+    ImportTrace* m_trace;
+    char const* m_name;
+    char const* m_category;
+    TraceArg m_first;
+    TraceArg m_second;
+    // only read when there is a trace, zeroed anyway so the compiler can see it is never used uninitialised
+    ImportTrace::Clock::time_point m_start{};
+};
+
+// makes a trace the active one for as long as it is in scope
+class ScopedTrace {
+public:
+    explicit ScopedTrace(ImportTrace* trace) { ImportTrace::setActive(trace); }
+    ~ScopedTrace() { ImportTrace::setActive(nullptr); }
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+};
@@ -0,0 +1,178 @@
+#include "FitStrategies.hpp"
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+using namespace objects;
+using namespace fitting;
+
+namespace {
+    // how many of the most used colours are tried as the bottom layer
+    constexpr size_t backgroundCandidates = 4;
+    // a colour needs at least one pixel in this many to be worth trying as the background
+    constexpr size_t minBackgroundShare = 100;
+
+    // colours with the most pixels first, leaving out ones too rare to help
+    std::vector<uint32_t> mostUsedColours(ImageView const& image, size_t count) {
+        // misra gries keeps every colour that could have one pixel in minBackgroundShare
+        // with a small table, so noisy images with millions of colours stay fast
+        std::unordered_map<uint32_t, size_t> candidates;
+        size_t opaque = 0;
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                if (!image.isOpaque(x, y)) {
+                    continue;
+                }
+                opaque++;
+                uint32_t colour = image.colour(x, y);
+                if (auto found = candidates.find(colour); found != candidates.end()) {
+                    found->second++;
+                }
+                else if (candidates.size() < minBackgroundShare) {
+                    candidates.emplace(colour, 1);
+                }
+                else {
+                    for (auto entry = candidates.begin(); entry != candidates.end();) {
+                        entry = --entry->second == 0 ? candidates.erase(entry) : std::next(entry);
+                    }
+                }
+            }
+        }
+        // then counts the ones left properly
+        for (auto& entry : candidates) {
+            entry.second = 0;
+        }
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                if (image.isOpaque(x, y)) {
+                    if (auto found = candidates.find(image.colour(x, y)); found != candidates.end()) {
+                        found->second++;
+                    }
+                }
+            }
+        }
+        std::vector<std::pair<uint32_t, size_t>> sorted(candidates.begin(), candidates.end());
+        count = std::min(count, sorted.size());
+        // ties go to the smaller colour so the choice does not depend on the map order
+        std::partial_sort(sorted.begin(), sorted.begin() + count, sorted.end(), [](auto const& a, auto const& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        std::vector<uint32_t> colours;
+        for (size_t i = 0; i < count && sorted[i].second * minBackgroundShare >= opaque; ++i) {
+            colours.push_back(sorted[i].first);
+        }
+        return colours;
+    }
+
+    // the background colour is fitted on the bottom layer where its rectangles can run under any
+    // other opaque pixel, then every other colour is fitted on top like the rectangles mode
+    Generator<ObjectRecord> fitWithBackground(ImageView image, uint32_t background, FitSettings settings,
+        FitReport& report, ImportArena& arena) {
+        int width = image.width;
+        int height = image.height;
+        for (int layer = 0; layer < 2; ++layer) {
+            bool bottom = layer == 0;
+            PixelMask placed(width, height, arena);
+            // the bottom layer only starts on the background and the top layer never does
+            auto starts = [&](int x, int y) {
+                return !placed.test(x, y) && image.isOpaque(x, y) && (image.colour(x, y) == background) == bottom;
+            };
+            auto covers = [&](int x, int y, int startX, int startY) {
+                return bottom ? !placed.test(x, y) && image.isOpaque(x, y) :
+                    canTake(image, placed, x, y, startX, startY);
+            };
+            for (int y = height - 1; y >= 0; --y) {
+                passedDeadline(settings, report, y);
+                for (int x = 0; x < width;) {
+                    if (!starts(x, y)) {
+                        x++;
+                        continue;
+                    }
+                    // out of time, the rest of each layer goes in as plain rows
+                    if (report.pastDeadline) {
+                        auto record = takeRow(image, placed, x, y);
+                        record.layer = layer;
+                        co_yield record;
+                        x += record.width;
+                        continue;
+                    }
+                    ObjectRecord record{pixelObjID, x, y, 1, 1, image.colour(x, y), layer};
+                    while (x + record.width < width && record.width < maxStretchPixels &&
+                    covers(x + record.width, y, x, y)) {
+                        record.width++;
+                    }
+                    while (y - record.height >= 0 && record.height < maxStretchPixels) {
+                        int above = y - record.height;
+                        bool matches = true;
+                        for (int offset = 0; offset < record.width && matches; ++offset) {
+                            matches = covers(x + offset, above, x, y);
+                        }
+                        if (!matches) {
+                            break;
+                        }
+                        record.height++;
+                    }
+                    for (int row = 0; row < record.height; ++row) {
+                        for (int offset = 0; offset < record.width; ++offset) {
+                            placed.set(x + offset, y - row);
+                        }
+                    }
+                    co_yield record;
+                    x += record.width;
+                }
+            }
+        }
+    }
+}
+
+Generator<ObjectRecord> fitting::fitLayered(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena& arena) {
+    // one layer is the rectangles mode, every background has to beat it
+    // its records are kept in case none does, the layerings are only counted so the records of
+    // the losing ones are never kept
+    FitReport plainReport;
+    std::vector<ObjectRecord> plain;
+    for (auto const& record : fitRectangles(image, settings, plainReport, arena)) {
+        plain.push_back(record);
+    }
+    size_t bestCount = plain.size();
+    std::optional<uint32_t> bestBackground;
+    if (!plainReport.pastDeadline) {
+        for (uint32_t background : mostUsedColours(image, backgroundCandidates)) {
+            FitReport layeredReport;
+            size_t count = 0;
+            for (auto const& record : fitWithBackground(image, background, settings, layeredReport, arena)) {
+                (void)record;
+                // stops as soon as it can not win
+                if (layeredReport.pastDeadline || ++count >= bestCount) {
+                    break;
+                }
+            }
+            // out of time so it goes with the best one so far
+            if (layeredReport.pastDeadline) {
+                break;
+            }
+            if (count < bestCount) {
+                bestCount = count;
+                bestBackground = background;
+            }
+        }
+    }
+    // the first pass is handed out as it was, with the rows it fell back to if it ran out of time
+    if (!bestBackground) {
+        report.pastDeadline = plainReport.pastDeadline;
+        report.fallbackRows = plainReport.fallbackRows;
+        for (auto const& record : plain) {
+            co_yield record;
+        }
+        co_return;
+    }
+    std::vector<ObjectRecord>().swap(plain);
+    // the winner already finished once so it is run again without the time limit, counting the
+    // layerings could have used up the time it needs
+    settings.deadline.reset();
+    for (auto const& record : fitWithBackground(image, *bestBackground, settings, report, arena)) {
+        co_yield record;
+    }
+}
@@ -0,0 +1,144 @@
+#include "LevelString.hpp"
+#include "ImportTrace.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "Colour.hpp"
+#include "ObjectStore.hpp"
+#include "ThreadPool.hpp"
+
+using namespace objects;
+
+namespace {
+    // records each chunk writes, small enough to balance and big enough to not matter
+    constexpr size_t minChunkRecords = 2048;
+    // rough length of one object so the chunk buffers rarely grow
+    constexpr size_t expectedObjectLength = 112;
+
+    template <typename String>
+    void appendInt(String& out, long long value) {
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    // writes a number the same way an ostream does by default (%g)
+    // positions are nearly always whole or half numbers so those skip printf
+    template <typename String>
+    void appendNumber(String& out, double value) {
+        double magnitude = std::fabs(value);
+        bool whole = magnitude == std::floor(magnitude);
+        bool half = !whole && magnitude * 2 == std::floor(magnitude * 2);
+        if ((whole && magnitude < 1e6) || (half && magnitude < 1e5)) {
+            if (std::signbit(value)) {
+                out += '-';
+            }
+            appendInt(out, static_cast<long long>(magnitude));
+            if (half) {
+                out += ".5";
+            }
+            return;
+        }
+        char buffer[32];
+        int length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+        out.append(buffer, length);
+    }
+}
+
+ObjectPlacement placeObject(ObjectRecord const& record, ArtOrigin origin) {
+    // the old pixel is a different size so it is spaced out more
+    if (record.objectID == oldPixelObjID) {
+        return ObjectPlacement{origin.x + record.x * (scale + 2.5f), origin.y - record.y * (scale + 2.5f),
+            objSize / 5, objSize / 5};
+    }
+    // objects are placed by their centre so it moves half the size along
+    return ObjectPlacement{origin.x + record.x * scale + (record.width - 1) * 0.5 * scale,
+        origin.y - record.y * scale + (record.height - 1) * 0.5 * scale,
+        objSize * record.width, objSize * record.height};
+}
+
+double pixelSpacing(int objectID) {
+    return objectID == oldPixelObjID ? scale + 2.5 : scale;
+}
+
+double unscaledSize(int objectID) {
+    // at scale 5 the new pixel objects are exactly one pixel wide
+    return objectID == oldPixelObjID ? scale + 2.5 : scale / objSize;
+}
+
+template <typename String>
+void appendObject(String& out, ObjectRecord const& record, ArtOrigin origin, std::string_view colour) {
+    auto placement = placeObject(record, origin);
+    out += "1,";
+    appendInt(out, record.objectID);
+    out += ",2,";
+    appendNumber(out, placement.x);
+    out += ",3,";
+    appendNumber(out, placement.y);
+    out += ",21,";
+    appendInt(out, colourChannel);
+    out += ",41,1,43,";
+    out.append(colour.data(), colour.size());
+    out += ",25,";
+    appendInt(out, zOrder + record.layer);
+    // squares use the normal scale and anything stretched uses the x and y scale
+    if (placement.scaleX == placement.scaleY) {
+        out += ",32,";
+        appendNumber(out, placement.scaleX);
+    }
+    else {
+        out += ",128,";
+        appendNumber(out, placement.scaleX);
+        out += ",129,";
+        appendNumber(out, placement.scaleY);
+    }
+    out += ';';
+}
+
+template void appendObject(std::string&, ObjectRecord const&, ArtOrigin, std::string_view);
+template void appendObject(ArenaString&, ObjectRecord const&, ArtOrigin, std::string_view);
+
+ArenaString buildLevelString(ObjectStore const& objects, ArtOrigin origin,
+    ColourPalette const& palette, ThreadPool& pool, ImportArena& arena) {
+    // a few chunks per thread so a slow chunk does not hold up the rest
+    size_t chunkSize = std::max(minChunkRecords, objects.size() / (pool.concurrency() * 4) + 1);
+    size_t chunkCount = (objects.size() + chunkSize - 1) / chunkSize;
+    // each chunk gets its own buffer so the workers never share one
+    ArenaVector<ArenaString> chunks(ArenaAllocator<ArenaString>{arena});
+    chunks.reserve(chunkCount);
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        chunks.emplace_back(ArenaAllocator<char>(arena));
+    }
+    pool.parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            size_t first = chunk * chunkSize;
+            size_t last = std::min(objects.size(), first + chunkSize);
+            TraceSpan span("write chunk", "serialize", {"chunk", static_cast<int64_t>(chunk)},
+                {"objects", static_cast<int64_t>(last - first)});
+            auto& buffer = chunks[chunk];
+            buffer.reserve((last - first) * expectedObjectLength);
+            for (size_t i = first; i < last; ++i) {
+                appendObject(buffer, objects.record(i), origin, palette.format(objects.colourIndices()[i]));
+            }
+        }
+    });
+    // joins the chunks in order with one allocation
+    ArenaVector<size_t> offsets(chunkCount + 1, 0, ArenaAllocator<size_t>(arena));
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        offsets[chunk + 1] = offsets[chunk] + chunks[chunk].size();
+    }
+    TraceSpan joinSpan("join chunks", "serialize", {"bytes", static_cast<int64_t>(offsets[chunkCount])});
+    ArenaString levelString(offsets[chunkCount], '\0', ArenaAllocator<char>(arena));
+    pool.parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; ++chunk) {
+            std::memcpy(levelString.data() + offsets[chunk], chunks[chunk].data(), chunks[chunk].size());
+        }
+    });
+    // removes the last ;
+    if (!levelString.empty()) {
+        levelString.pop_back();
+    }
+    return levelString;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "ImportArena.hpp"
+#include "ObjectRecord.hpp"
+
+class ColourPalette;
+class ObjectStore;
+class ThreadPool;
+
+// position of the selected object the art is built from
+struct ArtOrigin {
+    float x;
+    float y;
+};
+
+// where an object goes in the level and how big it is, the level string is written from this
+struct ObjectPlacement {
+    // centre of the object
+    double x;
+    double y;
+    // the 32 key is used when these match, otherwise 128 and 129
+    double scaleX;
+    double scaleY;
+};
+
+ObjectPlacement placeObject(ObjectRecord const& record, ArtOrigin origin);
+
+// distance between pixels in the level and the size of an object at scale 1,
+// the old pixel object is bigger than the others
+double pixelSpacing(int objectID);
+double unscaledSize(int objectID);
+
+// appends one object in the level string format, ending in a ;
+// works with std::string and ArenaString
+template <typename String>
+void appendObject(String& out, ObjectRecord const& record, ArtOrigin origin, std::string_view colour);
+
+// turns the objects into the string createObjectsFromString takes
+// chunks of objects are written in parallel and then joined in order
+// so the result is the same as writing them one after another
+// the palette has to be made from the store's colours
+ArenaString buildLevelString(ObjectStore const& objects, ArtOrigin origin,
+    ColourPalette const& palette, ThreadPool& pool, ImportArena& arena);
@@ -0,0 +1,168 @@
+#include "MemoryBudget.hpp"
+#include <algorithm>
+#include "ObjectStore.hpp"
+#include "PixelMask.hpp"
+#include "SquareMap.hpp"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#elif defined(__APPLE__)
+    #include <TargetConditionals.h>
+    #include <mach/mach.h>
+    #if TARGET_OS_IPHONE
+        #include <os/proc.h>
+    #endif
+#elif defined(__linux__) || defined(__ANDROID__)
+    #include <cstdio>
+    #include <cstring>
+    #if defined(__GLIBC__)
+        #include <malloc.h>
+    #endif
+#endif
+
+namespace {
+    // phones kill the game well before memory actually runs out so they get less of it
+#if defined(__ANDROID__) || (defined(__APPLE__) && TARGET_OS_IPHONE)
+    constexpr size_t budgetPercent = 40;
+#else
+    constexpr size_t budgetPercent = 60;
+#endif
+    // worst case every pixel is its own object, which is kept in the store,
+    // its chunk buffer, the joined string and the copy the game makes of it
+    constexpr size_t bytesPerObjectInMemory = ObjectStore::bytesPerObject + 3 * 112;
+    // smallest band budget worth tiling with and the most it needs
+    constexpr size_t minTiledBudget = 4 * 1024 * 1024;
+    constexpr size_t maxTiledBudget = 64 * 1024 * 1024;
+}
+
+std::optional<size_t> availableMemory() {
+#if defined(_WIN32)
+    MEMORYSTATUSEX status{};
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        // 32 bit processes can only use what is left of their own address space
+        return static_cast<size_t>(std::min(status.ullAvailPhys, status.ullAvailVirtual));
+    }
+    return std::nullopt;
+#elif defined(__APPLE__) && TARGET_OS_IPHONE
+    // ios gives each app a limit, this is what is left of it
+    if (__builtin_available(iOS 13.0, *)) {
+        size_t left = os_proc_available_memory();
+        if (left > 0) {
+            return left;
+        }
+    }
+    return std::nullopt;
+#elif defined(__APPLE__)
+    vm_statistics64_data_t stats{};
+    mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+    if (host_statistics64(mach_host_self(), HOST_VM_INFO64,
+        reinterpret_cast<host_info64_t>(&stats), &count) != KERN_SUCCESS) {
+        return std::nullopt;
+    }
+    // inactive pages can be taken back without swapping
+    return static_cast<size_t>(stats.free_count + stats.inactive_count) * vm_page_size;
+#elif defined(__linux__) || defined(__ANDROID__)
+    FILE* file = std::fopen("/proc/meminfo", "r");
+    if (!file) {
+        return std::nullopt;
+    }
+    char line[256];
+    std::optional<size_t> available;
+    while (std::fgets(line, sizeof(line), file)) {
+        unsigned long long kilobytes = 0;
+        if (std::sscanf(line, "MemAvailable: %llu kB", &kilobytes) == 1) {
+            available = static_cast<size_t>(kilobytes) * 1024;
+            break;
+        }
+    }
+    std::fclose(file);
+    return available;
+#else
+    return std::nullopt;
+#endif
+}
+
+ResidentMemory residentMemory() {
+    ResidentMemory memory;
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        memory.current = counters.WorkingSetSize;
+        memory.peak = counters.PeakWorkingSetSize;
+    }
+#elif defined(__APPLE__)
+    mach_task_basic_info_data_t info{};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info),
+        &count) == KERN_SUCCESS) {
+        memory.current = static_cast<size_t>(info.resident_size);
+        memory.peak = static_cast<size_t>(info.resident_size_max);
+    }
+#elif defined(__linux__) || defined(__ANDROID__)
+    FILE* file = std::fopen("/proc/self/status", "r");
+    if (!file) {
+        return memory;
+    }
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        unsigned long long kilobytes = 0;
+        if (std::sscanf(line, "VmRSS: %llu kB", &kilobytes) == 1) {
+            memory.current = static_cast<size_t>(kilobytes) * 1024;
+        }
+        // the high water mark is the peak resident size
+        else if (std::sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1) {
+            memory.peak = static_cast<size_t>(kilobytes) * 1024;
+        }
+    }
+    std::fclose(file);
+#endif
+    return memory;
+}
+
+bool resetPeakResidentMemory() {
+#if defined(__linux__) || defined(__ANDROID__)
+#if defined(__GLIBC__)
+    // glibc keeps freed memory around, without this the peak never gets below the biggest earlier case
+    malloc_trim(0);
+#endif
+    // 5 clears the high water mark and leaves the rest of the counters alone
+    FILE* file = std::fopen("/proc/self/clear_refs", "w");
+    if (!file) {
+        return false;
+    }
+    bool cleared = std::fputs("5", file) >= 0;
+    return std::fclose(file) == 0 && cleared;
+#else
+    return false;
+#endif
+}
+
+MemoryPlan planImportMemory(int width, int height, int channels, std::optional<size_t> available) {
+    MemoryPlan plan;
+    size_t pixels = static_cast<size_t>(width) * height;
+    plan.decodedBytes = pixels * channels;
+    plan.inMemoryBytes = plan.decodedBytes + PixelMask::bytesFor(width, height) + SquareMap::bytesFor(width, height) +
+        pixels * bytesPerObjectInMemory;
+    plan.minimumBytes = std::min(plan.inMemoryBytes, plan.decodedBytes + minTiledBudget);
+    // without knowing how much is free it has to trust the image fits
+    if (!available) {
+        plan.budget = plan.inMemoryBytes;
+        return plan;
+    }
+    plan.budget = *available / 100 * budgetPercent;
+    if (plan.inMemoryBytes <= plan.budget) {
+        return plan;
+    }
+    // tiling still needs the whole decoded image for a moment, plus a band
+    if (plan.minimumBytes <= plan.budget) {
+        plan.strategy = MemoryPlan::Strategy::Tiled;
+        plan.tiledBudget = std::min(maxTiledBudget, plan.budget - plan.decodedBytes);
+        return plan;
+    }
+    plan.strategy = MemoryPlan::Strategy::Refuse;
+    return plan;
+}
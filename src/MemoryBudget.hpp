@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+// how much memory the game can still use before it gets killed
+// or nothing if the platform does not say
+std::optional<size_t> availableMemory();
+
+// memory the game is using, 0 when the platform does not say
+struct ResidentMemory {
+    size_t current = 0;
+    // the most it has used since it started
+    size_t peak = 0;
+};
+
+ResidentMemory residentMemory();
+
+// starts the peak over from what is used now so one stage can be measured on its own,
+// returns false when the platform can not do that and the peak stays since it started
+bool resetPeakResidentMemory();
+
+// how an import should run given the memory it has
+struct MemoryPlan {
+    enum class Strategy {
+        // everything stays in memory, this is the fastest
+        InMemory,
+        // bands and records are spilled to disk and inserted in batches
+        Tiled,
+        // not even the decoded image fits
+        Refuse,
+    };
+
+    Strategy strategy = Strategy::InMemory;
+    // the part of the available memory the import allows itself
+    size_t budget = 0;
+    // what importing fully in memory would need at most
+    size_t inMemoryBytes = 0;
+    // what the decoded image alone needs
+    size_t decodedBytes = 0;
+    // the least the import can work with, which is tiling with the smallest bands
+    size_t minimumBytes = 0;
+    // memory left for the bands when tiled
+    size_t tiledBudget = 0;
+};
+
+// picks the strategy for an image before it is decoded
+MemoryPlan planImportMemory(int width, int height, int channels, std::optional<size_t> available);
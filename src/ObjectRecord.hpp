@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+namespace objects {
+    // object IDs for various object sizes
+    constexpr int pixelObjID = 3097;
+    constexpr int medPixelObjID = 3094;
+    constexpr int bigPixelObjID = 3093;
+    constexpr int largePixelObjID = 3092;
+
+    // object ID of old pixel object
+    constexpr int oldPixelObjID = 917;
+
+    // black color channel
+    constexpr int colourChannel = 1010;
+
+    // z order layering, the first layer uses this and each layer after goes one above
+    constexpr int zOrder = 1;
+
+    // size of the objects
+    constexpr float objSize = 5.0f;
+
+    // scale used for moving between pixels
+    constexpr float scale = 5;
+
+    // most pixels one object is stretched over in either direction,
+    // keeps the x and y scale inside what the editor lets you type in
+    constexpr int maxStretchPixels = 200;
+}
+
+// one object the fitter wants placed, in pixels so it does not depend
+// on where the art ends up in the level
+struct ObjectRecord {
+    int objectID;
+    // pixel the object starts at, objects grow right and up from it
+    int x;
+    int y;
+    // size of the object in pixels
+    int width;
+    int height;
+    // packed rgb, see packColour
+    uint32_t colour;
+    // objects on a higher layer are drawn over the ones below, so lower ones
+    // can run under pixels of other colours
+    int layer = 0;
+};
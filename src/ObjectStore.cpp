@@ -0,0 +1,60 @@
+#include "ObjectStore.hpp"
+
+ObjectStore::ObjectStore(ImportArena& arena)
+    : m_ids(ArenaAllocator<uint16_t>(arena)),
+    m_x(ArenaAllocator<uint16_t>(arena)),
+    m_y(ArenaAllocator<uint16_t>(arena)),
+    m_width(ArenaAllocator<uint16_t>(arena)),
+    m_height(ArenaAllocator<uint16_t>(arena)),
+    m_layers(ArenaAllocator<uint8_t>(arena)),
+    m_colourIndex(ArenaAllocator<uint32_t>(arena)),
+    m_colours(ArenaAllocator<uint32_t>(arena)),
+    m_colourLookup(256, std::hash<uint32_t>(), std::equal_to<uint32_t>(),
+        ArenaAllocator<std::pair<const uint32_t, uint32_t>>(arena)) {}
+
+void ObjectStore::reserve(size_t count) {
+    m_ids.reserve(count);
+    m_x.reserve(count);
+    m_y.reserve(count);
+    m_width.reserve(count);
+    m_height.reserve(count);
+    m_layers.reserve(count);
+    m_colourIndex.reserve(count);
+}
+
+void ObjectStore::push(ObjectRecord const& record) {
+    m_ids.push_back(static_cast<uint16_t>(record.objectID));
+    m_x.push_back(static_cast<uint16_t>(record.x));
+    m_y.push_back(static_cast<uint16_t>(record.y));
+    m_width.push_back(static_cast<uint16_t>(record.width));
+    m_height.push_back(static_cast<uint16_t>(record.height));
+    m_layers.push_back(static_cast<uint8_t>(record.layer));
+    // the same colour nearly always comes up again so it is only stored once
+    auto [entry, added] = m_colourLookup.try_emplace(record.colour, static_cast<uint32_t>(m_colours.size()));
+    if (added) {
+        m_colours.push_back(record.colour);
+    }
+    m_colourIndex.push_back(entry->second);
+}
+
+void ObjectStore::clear() {
+    m_ids.clear();
+    m_x.clear();
+    m_y.clear();
+    m_width.clear();
+    m_height.clear();
+    m_layers.clear();
+    m_colourIndex.clear();
+    m_colours.clear();
+    m_colourLookup.clear();
+}
+
+size_t ObjectStore::memoryBytes() const {
+    size_t columns = (m_ids.capacity() + m_x.capacity() + m_y.capacity() + m_width.capacity() +
+        m_height.capacity()) * sizeof(uint16_t) + (m_colourIndex.capacity() + m_colours.capacity()) * sizeof(uint32_t) +
+        m_layers.capacity() * sizeof(uint8_t);
+    // each lookup entry is a node plus its bucket
+    size_t lookup = m_colourLookup.size() * (sizeof(std::pair<const uint32_t, uint32_t>) + 2 * sizeof(void*)) +
+        m_colourLookup.bucket_count() * sizeof(void*);
+    return columns + lookup;
+}
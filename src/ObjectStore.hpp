@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include "ImportArena.hpp"
+#include "ObjectRecord.hpp"
+
+// compact column store of the objects an import makes
+// each column is a packed array so the objects are cheap to sort, count,
+// transform and write out, and colours are stored once in a table
+class ObjectStore {
+public:
+    // biggest position or size a column can hold
+    static constexpr int maxCoordinate = UINT16_MAX;
+    // bytes each object takes across the columns
+    static constexpr size_t bytesPerObject = sizeof(uint16_t) * 5 + sizeof(uint32_t) + sizeof(uint8_t);
+
+    explicit ObjectStore(ImportArena& arena);
+
+    void reserve(size_t count);
+    void push(ObjectRecord const& record);
+    void clear();
+
+    size_t size() const { return m_ids.size(); }
+    // roughly what the columns and the colour table take up
+    size_t memoryBytes() const;
+    bool empty() const { return m_ids.empty(); }
+
+    // puts a row back together as a record
+    ObjectRecord record(size_t index) const {
+        return ObjectRecord{m_ids[index], m_x[index], m_y[index], m_width[index], m_height[index],
+            m_colours[m_colourIndex[index]], m_layers[index]};
+    }
+
+    std::span<const uint16_t> ids() const { return m_ids; }
+    std::span<const uint16_t> xs() const { return m_x; }
+    std::span<const uint16_t> ys() const { return m_y; }
+    std::span<const uint16_t> widths() const { return m_width; }
+    std::span<const uint16_t> heights() const { return m_height; }
+    std::span<const uint8_t> layers() const { return m_layers; }
+    // index into colours() for each object
+    std::span<const uint32_t> colourIndices() const { return m_colourIndex; }
+    // every packed rgb colour used, in the order they were first seen
+    std::span<const uint32_t> colours() const { return m_colours; }
+
+private:
+    ArenaVector<uint16_t> m_ids;
+    ArenaVector<uint16_t> m_x;
+    ArenaVector<uint16_t> m_y;
+    ArenaVector<uint16_t> m_width;
+    ArenaVector<uint16_t> m_height;
+    ArenaVector<uint8_t> m_layers;
+    ArenaVector<uint32_t> m_colourIndex;
+    ArenaVector<uint32_t> m_colours;
+    ArenaMap<uint32_t, uint32_t> m_colourLookup;
+};
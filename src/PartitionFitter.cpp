@@ -0,0 +1,546 @@
+#include "FitStrategies.hpp"
+#include "RegionLabels.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <vector>
+
+using namespace objects;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // most time one region gets before it is fitted greedily instead
+    constexpr auto regionBudget = std::chrono::milliseconds(250);
+
+    // regions split together before their records are handed out, and how many each task takes
+    constexpr size_t regionBatch = 4096;
+    constexpr size_t regionGrain = 64;
+    // most concave corners a region can have and still be split exactly
+    constexpr size_t maxExactCorners = 200000;
+    // the exact split works over the region's whole box, so regions that only fill a little
+    // of a big box, like long diagonal lines, are fitted greedily from their own pixels instead
+    constexpr size_t maxBoxPerPixel = 16;
+    constexpr size_t alwaysExactBox = 4096;
+
+    // a rectangle of cells inside a region, in the region's own coordinates
+    struct Piece {
+        int left;
+        int top;
+        int width;
+        int height;
+    };
+
+    // a cut between two concave corners along a grid line, from and to are points on the line
+    struct Chord {
+        int line;
+        int from;
+        int to;
+    };
+
+    // which cells of a region's bounding box are in the region
+    struct RegionGrid {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> inside;
+
+        // cells outside the box count as outside the region
+        bool has(int x, int y) const {
+            return x >= 0 && y >= 0 && x < width && y < height && inside[static_cast<size_t>(y) * width + x];
+        }
+    };
+
+    // the pixels of every region, each region's in the order the fitters scan
+    class RegionPixels {
+    public:
+        RegionPixels(ImageView const& image, RegionLabels const& labels)
+            : m_width(image.width), m_starts(labels.regions().size() + 1, 0) {
+            auto const& regions = labels.regions();
+            for (size_t i = 0; i < regions.size(); ++i) {
+                m_starts[i + 1] = m_starts[i] + regions[i].pixels;
+            }
+            m_pixels.resize(m_starts.back());
+            std::vector<size_t> next(m_starts.begin(), m_starts.end() - 1);
+            for (int y = image.height - 1; y >= 0; --y) {
+                for (int x = 0; x < image.width; ++x) {
+                    uint32_t label = labels.label(x, y);
+                    if (label != RegionLabels::noRegion) {
+                        m_pixels[next[label]++] = static_cast<uint32_t>(static_cast<size_t>(y) * image.width + x);
+                    }
+                }
+            }
+        }
+
+        std::span<const uint32_t> of(uint32_t region) const {
+            return {m_pixels.data() + m_starts[region], m_pixels.data() + m_starts[region + 1]};
+        }
+        int width() const { return m_width; }
+
+    private:
+        int m_width;
+        std::vector<size_t> m_starts;
+        std::vector<uint32_t> m_pixels;
+    };
+
+    // fits a region row by row like the rectangles mode, used when the exact partition runs out of time
+    // it only looks at the region's own pixels and the ones next to them so a big box costs nothing,
+    // placed is shared by every region as they never touch each other's pixels
+    std::vector<Piece> greedyPieces(RegionLabels const& labels, RegionPixels const& pixels, uint32_t index,
+        std::vector<uint8_t>& placed) {
+        auto const& region = labels.regions()[index];
+        int width = pixels.width();
+        std::vector<Piece> pieces;
+        auto free = [&](int x, int y) {
+            return x <= region.right && y >= region.top && labels.label(x, y) == index &&
+                !placed[static_cast<size_t>(y) * width + x];
+        };
+        for (uint32_t pixel : pixels.of(index)) {
+            if (placed[pixel]) {
+                continue;
+            }
+            int x = static_cast<int>(pixel % width);
+            int y = static_cast<int>(pixel / width);
+            int pieceWidth = 1;
+            while (free(x + pieceWidth, y)) {
+                pieceWidth++;
+            }
+            int pieceHeight = 1;
+            while (true) {
+                bool matches = true;
+                for (int offset = 0; offset < pieceWidth && matches; ++offset) {
+                    matches = free(x + offset, y - pieceHeight);
+                }
+                if (!matches) {
+                    break;
+                }
+                pieceHeight++;
+            }
+            for (int row = 0; row < pieceHeight; ++row) {
+                for (int offset = 0; offset < pieceWidth; ++offset) {
+                    placed[static_cast<size_t>(y - row) * width + x + offset] = 1;
+                }
+            }
+            pieces.push_back(Piece{x - region.left, y - pieceHeight + 1 - region.top, pieceWidth, pieceHeight});
+        }
+        return pieces;
+    }
+
+    // splits a region into the fewest rectangles that do not overlap
+    // a concave corner is a grid point with 3 of its 4 cells inside, and each one needs a cut
+    // a good chord joins two concave corners so one cut fixes both, the most good chords that
+    // do not touch is the maximum independent set of the bipartite graph of horizontal against
+    // vertical chords, which by konigs theorem is every chord minus a maximum matching
+    // the rest of the concave corners get one cut each and the pieces left are the answer
+    class ExactPartition {
+    public:
+        ExactPartition(RegionGrid const& region, Clock::time_point deadline, std::atomic<bool> const* cancelled)
+            : m_region(region), m_deadline(deadline), m_cancelled(cancelled), m_width(region.width),
+            m_height(region.height),
+            m_horizontalCuts(static_cast<size_t>(region.width) * (region.height + 1), 0),
+            m_verticalCuts(static_cast<size_t>(region.width + 1) * region.height, 0) {}
+
+        // nothing if it ran out of time
+        std::optional<std::vector<Piece>> solve() {
+            findConcaveCorners();
+            // regions this jagged would not finish in time anyway so they go straight to greedy
+            if (m_corners.size() > maxExactCorners) {
+                return std::nullopt;
+            }
+            findGoodChords();
+            auto chosen = independentChords();
+            if (!chosen) {
+                return std::nullopt;
+            }
+            for (size_t i : chosen->first) {
+                auto const& chord = m_horizontalChords[i];
+                for (int x = chord.from; x < chord.to; ++x) {
+                    m_horizontalCuts[horizontalIndex(x, chord.line)] = 1;
+                }
+            }
+            for (size_t i : chosen->second) {
+                auto const& chord = m_verticalChords[i];
+                for (int y = chord.from; y < chord.to; ++y) {
+                    m_verticalCuts[verticalIndex(chord.line, y)] = 1;
+                }
+            }
+            cutRemainingCorners();
+            return collectPieces();
+        }
+
+    private:
+        size_t horizontalIndex(int x, int y) const { return static_cast<size_t>(y) * m_width + x; }
+        size_t verticalIndex(int x, int y) const { return static_cast<size_t>(x) * m_height + y; }
+
+        // a segment of a grid line is inside when the cells on both sides are
+        bool horizontalInside(int x, int y) const { return m_region.has(x, y - 1) && m_region.has(x, y); }
+        bool verticalInside(int x, int y) const { return m_region.has(x - 1, y) && m_region.has(x, y); }
+
+        bool concave(int x, int y) const {
+            int count = m_region.has(x - 1, y - 1) + m_region.has(x, y - 1) + m_region.has(x - 1, y) +
+                m_region.has(x, y);
+            return count == 3;
+        }
+
+        void findConcaveCorners() {
+            for (int y = 1; y < m_height; ++y) {
+                for (int x = 1; x < m_width; ++x) {
+                    if (concave(x, y)) {
+                        m_corners.emplace_back(x, y);
+                    }
+                }
+            }
+        }
+
+        // each good chord is found once, walking right or down from its first corner
+        void findGoodChords() {
+            for (auto [x, y] : m_corners) {
+                if (horizontalInside(x, y)) {
+                    int end = x + 1;
+                    while (horizontalInside(end, y)) {
+                        end++;
+                    }
+                    if (concave(end, y)) {
+                        m_horizontalChords.push_back(Chord{y, x, end});
+                    }
+                }
+                if (verticalInside(x, y)) {
+                    int end = y + 1;
+                    while (verticalInside(x, end)) {
+                        end++;
+                    }
+                    if (concave(x, end)) {
+                        m_verticalChords.push_back(Chord{x, y, end});
+                    }
+                }
+            }
+        }
+
+        // chords that share a point can not both be used, ends count as well
+        static bool crosses(Chord const& horizontal, Chord const& vertical) {
+            return vertical.line >= horizontal.from && vertical.line <= horizontal.to &&
+                horizontal.line >= vertical.from && horizontal.line <= vertical.to;
+        }
+
+        bool outOfTime() const { return (m_cancelled && *m_cancelled) || Clock::now() > m_deadline; }
+
+        // hopcroft karp matching then the independent set from the minimum vertex cover
+        std::optional<std::pair<std::vector<size_t>, std::vector<size_t>>> independentChords() {
+            size_t left = m_horizontalChords.size();
+            size_t right = m_verticalChords.size();
+            // vertical chords grouped by the column they are on so each horizontal one only checks its span
+            std::vector<std::vector<uint32_t>> byColumn(static_cast<size_t>(m_width) + 1);
+            for (size_t v = 0; v < right; ++v) {
+                byColumn[m_verticalChords[v].line].push_back(static_cast<uint32_t>(v));
+            }
+            std::vector<std::vector<uint32_t>> edges(left);
+            for (size_t h = 0; h < left; ++h) {
+                auto const& horizontal = m_horizontalChords[h];
+                for (int x = horizontal.from; x <= horizontal.to; ++x) {
+                    for (uint32_t v : byColumn[x]) {
+                        if (crosses(horizontal, m_verticalChords[v])) {
+                            edges[h].push_back(v);
+                        }
+                    }
+                }
+                if (h % 64 == 0 && outOfTime()) {
+                    return std::nullopt;
+                }
+            }
+
+            constexpr uint32_t none = UINT32_MAX;
+            std::vector<uint32_t> matchLeft(left, none);
+            std::vector<uint32_t> matchRight(right, none);
+            std::vector<uint32_t> distance(left);
+            std::vector<uint32_t> queue;
+            // layers the unmatched left side and returns if there is any augmenting path
+            auto layer = [&] {
+                queue.clear();
+                bool found = false;
+                for (size_t h = 0; h < left; ++h) {
+                    distance[h] = matchLeft[h] == none ? 0 : none;
+                    if (matchLeft[h] == none) {
+                        queue.push_back(static_cast<uint32_t>(h));
+                    }
+                }
+                for (size_t head = 0; head < queue.size(); ++head) {
+                    uint32_t h = queue[head];
+                    for (uint32_t v : edges[h]) {
+                        uint32_t next = matchRight[v];
+                        if (next == none) {
+                            found = true;
+                        }
+                        else if (distance[next] == none) {
+                            distance[next] = distance[h] + 1;
+                            queue.push_back(next);
+                        }
+                    }
+                }
+                return found;
+            };
+            std::vector<size_t> nextEdge(left);
+            // iterative so huge regions can not overflow the stack
+            auto augment = [&](uint32_t start) {
+                std::vector<uint32_t> path{start};
+                while (!path.empty()) {
+                    uint32_t h = path.back();
+                    bool advanced = false;
+                    while (nextEdge[h] < edges[h].size()) {
+                        uint32_t v = edges[h][nextEdge[h]++];
+                        uint32_t next = matchRight[v];
+                        if (next == none) {
+                            // flips the matching along the path
+                            for (size_t i = path.size(); i-- > 0;) {
+                                uint32_t node = path[i];
+                                uint32_t previous = matchLeft[node];
+                                matchLeft[node] = v;
+                                matchRight[v] = node;
+                                v = previous;
+                            }
+                            return true;
+                        }
+                        if (distance[next] == distance[h] + 1) {
+                            path.push_back(next);
+                            advanced = true;
+                            break;
+                        }
+                    }
+                    if (!advanced) {
+                        distance[h] = none;
+                        path.pop_back();
+                    }
+                }
+                return false;
+            };
+            while (layer()) {
+                if (outOfTime()) {
+                    return std::nullopt;
+                }
+                std::fill(nextEdge.begin(), nextEdge.end(), 0);
+                for (size_t h = 0; h < left; ++h) {
+                    if (matchLeft[h] == none) {
+                        augment(static_cast<uint32_t>(h));
+                    }
+                }
+            }
+
+            // everything reachable from an unmatched horizontal chord by alternating paths
+            std::vector<uint8_t> reachedLeft(left, 0);
+            std::vector<uint8_t> reachedRight(right, 0);
+            queue.clear();
+            for (size_t h = 0; h < left; ++h) {
+                if (matchLeft[h] == none) {
+                    reachedLeft[h] = 1;
+                    queue.push_back(static_cast<uint32_t>(h));
+                }
+            }
+            for (size_t head = 0; head < queue.size(); ++head) {
+                for (uint32_t v : edges[queue[head]]) {
+                    if (reachedRight[v]) {
+                        continue;
+                    }
+                    reachedRight[v] = 1;
+                    uint32_t next = matchRight[v];
+                    if (next != none && !reachedLeft[next]) {
+                        reachedLeft[next] = 1;
+                        queue.push_back(next);
+                    }
+                }
+            }
+            // the cover is the unreached left and the reached right, the rest is independent
+            std::pair<std::vector<size_t>, std::vector<size_t>> chosen;
+            for (size_t h = 0; h < left; ++h) {
+                if (reachedLeft[h]) {
+                    chosen.first.push_back(h);
+                }
+            }
+            for (size_t v = 0; v < right; ++v) {
+                if (!reachedRight[v]) {
+                    chosen.second.push_back(v);
+                }
+            }
+            return chosen;
+        }
+
+        bool hasCutAt(int x, int y) const {
+            return (x > 0 && m_horizontalCuts[horizontalIndex(x - 1, y)]) ||
+                (x < m_width && m_horizontalCuts[horizontalIndex(x, y)]) ||
+                (y > 0 && m_verticalCuts[verticalIndex(x, y - 1)]) ||
+                (y < m_height && m_verticalCuts[verticalIndex(x, y)]);
+        }
+
+        // any corner without a cut yet gets one straight up or down until it meets something
+        void cutRemainingCorners() {
+            for (auto [x, y] : m_corners) {
+                if (hasCutAt(x, y)) {
+                    continue;
+                }
+                int step = verticalInside(x, y) ? 1 : -1;
+                int at = y;
+                while (true) {
+                    int segment = step > 0 ? at : at - 1;
+                    if (!verticalInside(x, segment)) {
+                        break;
+                    }
+                    m_verticalCuts[verticalIndex(x, segment)] = 1;
+                    at += step;
+                    // stops at the first cut it meets, the segment it came along does not count
+                    bool blocked = (x > 0 && m_horizontalCuts[horizontalIndex(x - 1, at)]) ||
+                        (x < m_width && m_horizontalCuts[horizontalIndex(x, at)]) ||
+                        (step > 0 && at < m_height && m_verticalCuts[verticalIndex(x, at)]) ||
+                        (step < 0 && at > 0 && m_verticalCuts[verticalIndex(x, at - 1)]);
+                    if (blocked) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        // flood fills the cells between the cuts, every piece should come out as a rectangle
+        std::optional<std::vector<Piece>> collectPieces() {
+            std::vector<Piece> pieces;
+            std::vector<uint8_t> seen(m_region.inside.size(), 0);
+            std::vector<std::pair<int, int>> stack;
+            for (int y = 0; y < m_height; ++y) {
+                for (int x = 0; x < m_width; ++x) {
+                    if (!m_region.has(x, y) || seen[static_cast<size_t>(y) * m_width + x]) {
+                        continue;
+                    }
+                    int left = x;
+                    int right = x;
+                    int top = y;
+                    int bottom = y;
+                    size_t cells = 0;
+                    seen[static_cast<size_t>(y) * m_width + x] = 1;
+                    stack.emplace_back(x, y);
+                    while (!stack.empty()) {
+                        auto [cx, cy] = stack.back();
+                        stack.pop_back();
+                        cells++;
+                        left = std::min(left, cx);
+                        right = std::max(right, cx);
+                        top = std::min(top, cy);
+                        bottom = std::max(bottom, cy);
+                        auto visit = [&](int nx, int ny, bool cut) {
+                            if (cut || !m_region.has(nx, ny) || seen[static_cast<size_t>(ny) * m_width + nx]) {
+                                return;
+                            }
+                            seen[static_cast<size_t>(ny) * m_width + nx] = 1;
+                            stack.emplace_back(nx, ny);
+                        };
+                        visit(cx - 1, cy, m_verticalCuts[verticalIndex(cx, cy)]);
+                        visit(cx + 1, cy, m_verticalCuts[verticalIndex(cx + 1, cy)]);
+                        visit(cx, cy - 1, m_horizontalCuts[horizontalIndex(cx, cy)]);
+                        visit(cx, cy + 1, m_horizontalCuts[horizontalIndex(cx, cy + 1)]);
+                    }
+                    int width = right - left + 1;
+                    int height = bottom - top + 1;
+                    if (cells != static_cast<size_t>(width) * height) {
+                        return std::nullopt;
+                    }
+                    pieces.push_back(Piece{left, top, width, height});
+                }
+            }
+            return pieces;
+        }
+
+        RegionGrid const& m_region;
+        Clock::time_point m_deadline;
+        std::atomic<bool> const* m_cancelled;
+        int m_width;
+        int m_height;
+        std::vector<std::pair<int, int>> m_corners;
+        std::vector<Chord> m_horizontalChords;
+        std::vector<Chord> m_verticalChords;
+        // cut segments, horizontal ones are indexed by line and then x, vertical ones by line and then y
+        std::vector<uint8_t> m_horizontalCuts;
+        std::vector<uint8_t> m_verticalCuts;
+    };
+
+    // pieces for one region, in the region's box
+    std::vector<Piece> splitRegion(RegionLabels const& labels, RegionPixels const& pixels, uint32_t index,
+        FitSettings const& settings, std::vector<uint8_t>& placed, bool& fellBack) {
+        auto const& region = labels.regions()[index];
+        if (region.isRectangle()) {
+            return {Piece{0, 0, region.width(), region.height()}};
+        }
+        size_t box = static_cast<size_t>(region.width()) * region.height();
+        if (box > alwaysExactBox && box > region.pixels * maxBoxPerPixel) {
+            return greedyPieces(labels, pixels, index, placed);
+        }
+        auto now = Clock::now();
+        // once the import is out of time every region left is done greedily
+        if (settings.outOfTime()) {
+            fellBack = true;
+            return greedyPieces(labels, pixels, index, placed);
+        }
+        RegionGrid grid;
+        grid.width = region.width();
+        grid.height = region.height();
+        grid.inside.assign(box, 0);
+        for (uint32_t pixel : pixels.of(index)) {
+            int x = static_cast<int>(pixel % pixels.width()) - region.left;
+            int y = static_cast<int>(pixel / pixels.width()) - region.top;
+            grid.inside[static_cast<size_t>(y) * grid.width + x] = 1;
+        }
+        auto deadline = now + regionBudget;
+        if (settings.deadline) {
+            deadline = std::min(deadline, *settings.deadline);
+        }
+        if (auto exact = ExactPartition(grid, deadline, settings.cancelled).solve()) {
+            return std::move(*exact);
+        }
+        fellBack = true;
+        return greedyPieces(labels, pixels, index, placed);
+    }
+}
+
+Generator<ObjectRecord> fitting::fitPartition(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena& arena) {
+    RegionLabels labels(image, arena);
+    RegionPixels pixels(image, labels);
+    std::vector<uint8_t> placed(static_cast<size_t>(image.width) * image.height, 0);
+    auto const& regions = labels.regions();
+    std::vector<std::vector<Piece>> pieces;
+    std::vector<uint8_t> fellBack;
+    // regions do not touch each other's pixels so a batch of them is split on the pool at once,
+    // then handed out in order so the records come out the same however many threads there are
+    for (size_t first = 0; first < regions.size(); first += regionBatch) {
+        size_t count = std::min(regionBatch, regions.size() - first);
+        pieces.assign(count, {});
+        fellBack.assign(count, 0);
+        auto split = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                bool regionFellBack = false;
+                pieces[i - first] = splitRegion(labels, pixels, static_cast<uint32_t>(i), settings, placed,
+                    regionFellBack);
+                fellBack[i - first] = regionFellBack;
+            }
+        };
+        if (settings.pool) {
+            settings.pool->parallelFor(first, first + count, regionGrain, split);
+        }
+        else {
+            split(first, first + count);
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            auto const& region = regions[first + i];
+            report.fallbackRegions += fellBack[i];
+            for (auto const& piece : pieces[i]) {
+                // pieces past the stretch limit are split into tiles that fit
+                for (int tileTop = 0; tileTop < piece.height; tileTop += maxStretchPixels) {
+                    for (int tileLeft = 0; tileLeft < piece.width; tileLeft += maxStretchPixels) {
+                        int tileWidth = std::min(maxStretchPixels, piece.width - tileLeft);
+                        int tileHeight = std::min(maxStretchPixels, piece.height - tileTop);
+                        // records start at the bottom left pixel and grow up
+                        co_yield ObjectRecord{pixelObjID, region.left + piece.left + tileLeft,
+                            region.top + piece.top + tileTop + tileHeight - 1, tileWidth, tileHeight, region.colour};
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include "ImportArena.hpp"
+
+// one bit per pixel, stored as a single flat array of words
+class PixelMask {
+public:
+    PixelMask(int width, int height, ImportArena& arena)
+        : m_width(width), m_height(height),
+        m_words((static_cast<size_t>(width) * height + 63) / 64, 0, ArenaAllocator<uint64_t>(arena)) {}
+
+    bool test(int x, int y) const {
+        size_t bit = index(x, y);
+        return (m_words[bit / 64] >> (bit % 64)) & 1;
+    }
+    void set(int x, int y) {
+        size_t bit = index(x, y);
+        m_words[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    void reset(int x, int y) {
+        size_t bit = index(x, y);
+        m_words[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+    }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // bytes a mask of this size takes
+    static size_t bytesFor(int width, int height) {
+        return (static_cast<size_t>(width) * height + 63) / 64 * sizeof(uint64_t);
+    }
+
+private:
+    size_t index(int x, int y) const { return static_cast<size_t>(y) * m_width + x; }
+
+    int m_width;
+    int m_height;
+    ArenaVector<uint64_t> m_words;
+};
@@ -0,0 +1,154 @@
+#include "FitStrategies.hpp"
+#include <array>
+#include <vector>
+#include "ThreadPool.hpp"
+
+using namespace objects;
+
+namespace {
+    // the biggest node is 128 pixels, one level more would be past the stretch limit
+    constexpr int topLevel = 7;
+    constexpr int tileSize = 1 << topLevel;
+    static_assert(tileSize <= maxStretchPixels);
+
+    // node keys, anything else is the packed rgb the whole node has
+    constexpr uint32_t seeThrough = UINT32_MAX;
+    constexpr uint32_t mixed = UINT32_MAX - 1;
+
+    // where each level of a tile starts, the levels are stored one after another
+    constexpr auto levelOffsets = [] {
+        std::array<size_t, topLevel + 2> offsets{};
+        for (int level = 1; level <= topLevel + 1; ++level) {
+            size_t side = tileSize >> (level - 1);
+            offsets[level] = offsets[level - 1] + side * side;
+        }
+        return offsets;
+    }();
+
+    // every level of one tile's tree, finest first, the tiles are built on their own
+    // so each one stays in cache and any number of them can be built at once
+    class TileTree {
+    public:
+        TileTree(ImageView const& image, int left, int top) : m_left(left), m_top(top) {
+            m_keys.resize(levelOffsets[topLevel + 1]);
+            // pixels past the edge of the image count as see through
+            for (int y = 0; y < tileSize; ++y) {
+                for (int x = 0; x < tileSize; ++x) {
+                    int imageX = left + x;
+                    int imageY = top + y;
+                    bool inside = imageX < image.width && imageY < image.height && image.isOpaque(imageX, imageY);
+                    m_keys[y * tileSize + x] = inside ? image.colour(imageX, imageY) : seeThrough;
+                }
+            }
+            // a node is uniform when all 4 children are the same, otherwise it gets split
+            for (int level = 1; level <= topLevel; ++level) {
+                int side = tileSize >> level;
+                for (int y = 0; y < side; ++y) {
+                    for (int x = 0; x < side; ++x) {
+                        uint32_t first = key(level - 1, x * 2, y * 2);
+                        bool same = first != mixed && key(level - 1, x * 2 + 1, y * 2) == first &&
+                            key(level - 1, x * 2, y * 2 + 1) == first && key(level - 1, x * 2 + 1, y * 2 + 1) == first;
+                        m_keys[levelOffsets[level] + y * side + x] = same ? first : mixed;
+                    }
+                }
+            }
+        }
+
+        // one object per uniform node that is not see through, bottom children first
+        // and pairs of uniform siblings with the same colour joined into one
+        void collect(std::vector<ObjectRecord>& records) const { collect(records, topLevel, 0, 0); }
+
+    private:
+        uint32_t key(int level, int x, int y) const {
+            return m_keys[levelOffsets[level] + static_cast<size_t>(y) * (tileSize >> level) + x];
+        }
+
+        void collect(std::vector<ObjectRecord>& records, int level, int x, int y) const {
+            uint32_t nodeKey = key(level, x, y);
+            if (nodeKey == seeThrough) {
+                return;
+            }
+            if (nodeKey != mixed) {
+                add(records, level, x, y, 1, 1, nodeKey);
+                return;
+            }
+            // y goes down so the bottom children are the odd ones
+            int childLevel = level - 1;
+            int left = x * 2;
+            int right = left + 1;
+            int top = y * 2;
+            int bottom = top + 1;
+            auto solid = [](uint32_t childKey) { return childKey != mixed && childKey != seeThrough; };
+            uint32_t bottomLeft = key(childLevel, left, bottom);
+            uint32_t bottomRight = key(childLevel, right, bottom);
+            uint32_t topLeft = key(childLevel, left, top);
+            uint32_t topRight = key(childLevel, right, top);
+            // two siblings of the same colour next to each other are one object
+            if (solid(bottomLeft) && bottomLeft == bottomRight) {
+                add(records, childLevel, left, bottom, 2, 1, bottomLeft);
+                if (solid(topLeft) && topLeft == topRight) {
+                    add(records, childLevel, left, top, 2, 1, topLeft);
+                    return;
+                }
+                collect(records, childLevel, left, top);
+                collect(records, childLevel, right, top);
+                return;
+            }
+            if (solid(bottomLeft) && bottomLeft == topLeft) {
+                add(records, childLevel, left, bottom, 1, 2, bottomLeft);
+                if (solid(bottomRight) && bottomRight == topRight) {
+                    add(records, childLevel, right, bottom, 1, 2, bottomRight);
+                    return;
+                }
+                collect(records, childLevel, right, bottom);
+                collect(records, childLevel, right, top);
+                return;
+            }
+            collect(records, childLevel, left, bottom);
+            collect(records, childLevel, right, bottom);
+            collect(records, childLevel, left, top);
+            collect(records, childLevel, right, top);
+        }
+
+        // columns and rows are in nodes of the level, and the node given is the bottom left one
+        void add(std::vector<ObjectRecord>& records, int level, int x, int y, int columns, int rows,
+            uint32_t colour) const {
+            int size = 1 << level;
+            // records start at the bottom left pixel and grow up
+            records.push_back(ObjectRecord{pixelObjID, m_left + x * size, m_top + (y + 1) * size - 1,
+                columns * size, rows * size, colour});
+        }
+
+        int m_left;
+        int m_top;
+        std::vector<uint32_t> m_keys;
+    };
+}
+
+Generator<ObjectRecord> fitting::fitQuadtree(ImageView image, FitSettings settings, FitReport&,
+    ImportArena&) {
+    // every tile is as quick as the plain row fallback so the time limit is not checked
+    int columns = (image.width + tileSize - 1) / tileSize;
+    int rows = (image.height + tileSize - 1) / tileSize;
+    std::vector<std::vector<ObjectRecord>> tileRecords(columns);
+    // a row of tiles is built on the pool at once, bottom row first like the other modes
+    for (int row = rows - 1; row >= 0; --row) {
+        auto build = [&](size_t begin, size_t end) {
+            for (size_t column = begin; column < end; ++column) {
+                tileRecords[column].clear();
+                TileTree(image, static_cast<int>(column) * tileSize, row * tileSize).collect(tileRecords[column]);
+            }
+        };
+        if (settings.pool) {
+            settings.pool->parallelFor(0, columns, 1, build);
+        }
+        else {
+            build(0, columns);
+        }
+        for (auto const& records : tileRecords) {
+            for (auto const& record : records) {
+                co_yield record;
+            }
+        }
+    }
+}
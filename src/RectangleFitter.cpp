@@ -0,0 +1,53 @@
+#include "FitStrategies.hpp"
+
+using namespace objects;
+
+Generator<ObjectRecord> fitting::fitRectangles(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena& arena) {
+    int width = image.width;
+    int height = image.height;
+    PixelMask placed(width, height, arena);
+    for (int y = height - 1; y >= 0; --y) {
+        passedDeadline(settings, report, y);
+        for (int x = 0; x < width;) {
+            if (placed.test(x, y) || !image.isOpaque(x, y)) {
+                x++;
+                continue;
+            }
+            if (report.pastDeadline) {
+                auto record = takeRow(image, placed, x, y);
+                co_yield record;
+                x += record.width;
+                continue;
+            }
+            // grows along the row first
+            ObjectRecord record{pixelObjID, x, y, 1, 1, image.colour(x, y)};
+            while (x + record.width < width && record.width < maxStretchPixels &&
+            canTake(image, placed, x + record.width, y, x, y)) {
+                record.width++;
+            }
+            // then upwards while the whole row above matches
+            while (y - record.height >= 0 && record.height < maxStretchPixels) {
+                int above = y - record.height;
+                bool matches = true;
+                for (int offset = 0; offset < record.width; ++offset) {
+                    if (!canTake(image, placed, x + offset, above, x, y)) {
+                        matches = false;
+                        break;
+                    }
+                }
+                if (!matches) {
+                    break;
+                }
+                record.height++;
+            }
+            for (int row = 0; row < record.height; ++row) {
+                for (int offset = 0; offset < record.width; ++offset) {
+                    placed.set(x + offset, y - row);
+                }
+            }
+            co_yield record;
+            x += record.width;
+        }
+    }
+}
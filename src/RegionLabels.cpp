@@ -0,0 +1,94 @@
+#include "RegionLabels.hpp"
+#include <algorithm>
+
+namespace {
+    uint32_t findRoot(ArenaVector<uint32_t>& parents, uint32_t label) {
+        while (parents[label] != label) {
+            // points every other step at its grandparent so the trees stay flat
+            parents[label] = parents[parents[label]];
+            label = parents[label];
+        }
+        return label;
+    }
+
+    // the smaller label always wins so the root is the first label the scan gave out
+    void join(ArenaVector<uint32_t>& parents, uint32_t first, uint32_t second) {
+        first = findRoot(parents, first);
+        second = findRoot(parents, second);
+        if (first < second) {
+            parents[second] = first;
+        }
+        else if (second < first) {
+            parents[first] = second;
+        }
+    }
+}
+
+RegionLabels::RegionLabels(ImageView image, ImportArena& arena)
+    : m_width(image.width),
+    m_labels(static_cast<size_t>(image.width) * image.height, noRegion, ArenaAllocator<uint32_t>(arena)),
+    m_regions(ArenaAllocator<Region>(arena)) {
+    int width = image.width;
+    int height = image.height;
+    ArenaVector<uint32_t> parents{ArenaAllocator<uint32_t>(arena)};
+    // first pass gives each pixel a label and joins it with the pixels to its left and below
+    for (int y = height - 1; y >= 0; --y) {
+        uint32_t* row = m_labels.data() + static_cast<size_t>(y) * width;
+        uint32_t const* below = y + 1 < height ? row + width : nullptr;
+        for (int x = 0; x < width; ++x) {
+            if (!image.isOpaque(x, y)) {
+                continue;
+            }
+            bool matchesLeft = x > 0 && row[x - 1] != noRegion && image.sameColour(x - 1, y, x, y);
+            bool matchesBelow = below && below[x] != noRegion && image.sameColour(x, y + 1, x, y);
+            if (matchesLeft && matchesBelow) {
+                row[x] = row[x - 1];
+                join(parents, row[x - 1], below[x]);
+            }
+            else if (matchesLeft) {
+                row[x] = row[x - 1];
+            }
+            else if (matchesBelow) {
+                row[x] = below[x];
+            }
+            else {
+                row[x] = static_cast<uint32_t>(parents.size());
+                parents.push_back(row[x]);
+            }
+        }
+    }
+
+    // roots are numbered in the order they were made, which is the scan order
+    ArenaVector<uint32_t> finalLabels(parents.size(), noRegion, ArenaAllocator<uint32_t>(arena));
+    for (uint32_t label = 0; label < parents.size(); ++label) {
+        uint32_t root = findRoot(parents, label);
+        if (root == label) {
+            finalLabels[label] = static_cast<uint32_t>(m_regions.size());
+            m_regions.push_back(Region{width, height, -1, -1, 0, 0});
+        }
+        else {
+            // the root always has a smaller label so it is already numbered
+            finalLabels[label] = finalLabels[root];
+        }
+    }
+
+    // second pass swaps in the final labels and grows each region's box
+    for (int y = height - 1; y >= 0; --y) {
+        uint32_t* row = m_labels.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            if (row[x] == noRegion) {
+                continue;
+            }
+            row[x] = finalLabels[row[x]];
+            auto& region = m_regions[row[x]];
+            if (region.pixels == 0) {
+                region.colour = image.colour(x, y);
+            }
+            region.pixels++;
+            region.left = std::min(region.left, x);
+            region.right = std::max(region.right, x);
+            region.top = std::min(region.top, y);
+            region.bottom = std::max(region.bottom, y);
+        }
+    }
+}
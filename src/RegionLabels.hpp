@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include "ImageView.hpp"
+#include "ImportArena.hpp"
+
+// one area of touching pixels with the same colour
+struct Region {
+    // bounding box, right and bottom are inclusive
+    int left;
+    int top;
+    int right;
+    int bottom;
+    size_t pixels;
+    uint32_t colour;
+
+    int width() const { return right - left + 1; }
+    int height() const { return bottom - top + 1; }
+    // the region fills its whole box so it is already a rectangle
+    bool isRectangle() const { return pixels == static_cast<size_t>(width()) * height(); }
+};
+
+// labels every opaque pixel with the region it is in, pixels only join
+// the ones above, below and to the sides of them if the rgb matches
+// regions are numbered in the order the fitters scan, bottom row first and left to right
+class RegionLabels {
+public:
+    static constexpr uint32_t noRegion = UINT32_MAX;
+
+    RegionLabels(ImageView image, ImportArena& arena);
+
+    uint32_t label(int x, int y) const { return m_labels[static_cast<size_t>(y) * m_width + x]; }
+    ArenaVector<Region> const& regions() const { return m_regions; }
+
+    // bytes the labels for an image this size take
+    static size_t bytesFor(int width, int height) { return static_cast<size_t>(width) * height * sizeof(uint32_t); }
+
+private:
+    int m_width;
+    ArenaVector<uint32_t> m_labels;
+    ArenaVector<Region> m_regions;
+};
@@ -0,0 +1,83 @@
+#include "FitStrategies.hpp"
+#include <utility>
+
+using namespace objects;
+
+namespace {
+    // see through pixels get a key no rgb colour can have
+    constexpr uint32_t noColour = UINT32_MAX;
+
+    // pixels of one colour next to each other on a row, with how many rows it has been stacked up
+    struct Run {
+        int start;
+        int length;
+        uint32_t colour;
+        // bottom row and how many rows above it have the exact same run
+        int bottom;
+        int height;
+    };
+
+    // packs each pixel of a row into one number so runs are found with plain compares
+    // the loops have no branches so the compiler can vectorise them
+    void rowKeys(ImageView const& image, int y, uint32_t* keys) {
+        unsigned char const* pixel = image.pixel(0, y);
+        if (image.channels == 4) {
+            for (int x = 0; x < image.width; ++x) {
+                uint32_t rgb = (static_cast<uint32_t>(pixel[x * 4]) << 16) |
+                    (static_cast<uint32_t>(pixel[x * 4 + 1]) << 8) | pixel[x * 4 + 2];
+                keys[x] = pixel[x * 4 + 3] ? rgb : noColour;
+            }
+        }
+        else {
+            int channels = image.channels;
+            for (int x = 0; x < image.width; ++x) {
+                unsigned char const* p = pixel + x * channels;
+                keys[x] = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+            }
+        }
+    }
+}
+
+Generator<ObjectRecord> fitting::fitRuns(ImageView image, FitSettings, FitReport&, ImportArena& arena) {
+    int width = image.width;
+    // every run is as fast as the plain row fallback so the time limit is not checked
+    ArenaVector<uint32_t> keys(static_cast<size_t>(width), 0, ArenaAllocator<uint32_t>(arena));
+    ArenaVector<Run> below{ArenaAllocator<Run>(arena)};
+    ArenaVector<Run> current{ArenaAllocator<Run>(arena)};
+    for (int y = image.height - 1; y >= 0; --y) {
+        rowKeys(image, y, keys.data());
+        current.clear();
+        // splits the row wherever the colour changes, long runs are cut at the stretch limit
+        for (int x = 0; x < width;) {
+            uint32_t colour = keys[x];
+            int end = x + 1;
+            while (end < width && keys[end] == colour && end - x < maxStretchPixels) {
+                end++;
+            }
+            if (colour != noColour) {
+                current.push_back(Run{x, end - x, colour, y, 1});
+            }
+            x = end;
+        }
+        // both rows are in order along x so matching runs are found in one walk
+        size_t next = 0;
+        for (auto const& run : below) {
+            while (next < current.size() && current[next].start < run.start) {
+                next++;
+            }
+            auto* above = next < current.size() ? &current[next] : nullptr;
+            if (above && above->start == run.start && above->length == run.length &&
+            above->colour == run.colour && run.height < maxStretchPixels) {
+                above->bottom = run.bottom;
+                above->height = run.height + 1;
+                continue;
+            }
+            // the run stops here so it becomes an object
+            co_yield ObjectRecord{pixelObjID, run.start, run.bottom, run.length, run.height, run.colour};
+        }
+        std::swap(below, current);
+    }
+    for (auto const& run : below) {
+        co_yield ObjectRecord{pixelObjID, run.start, run.bottom, run.length, run.height, run.colour};
+    }
+}
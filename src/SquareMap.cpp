@@ -0,0 +1,27 @@
+#include "SquareMap.hpp"
+#include <algorithm>
+
+SquareMap::SquareMap(ImageView image, ImportArena& arena)
+    : m_width(image.width), m_height(image.height),
+    m_sides(bytesFor(image.width, image.height), 0, ArenaAllocator<uint8_t>(arena)) {
+    // the rows above and the pixels to the right are always done first
+    for (int y = 0; y < m_height; ++y) {
+        uint8_t* row = m_sides.data() + static_cast<size_t>(y) * m_width;
+        uint8_t const* above = y > 0 ? row - m_width : nullptr;
+        for (int x = m_width - 1; x >= 0; --x) {
+            if (!image.isOpaque(x, y)) {
+                continue;
+            }
+            // a square one bigger than the smallest of its 3 neighbours fits if they are all this colour
+            if (above && x + 1 < m_width && row[x + 1] && above[x] && above[x + 1] &&
+            image.sameColour(x + 1, y, x, y) && image.sameColour(x, y - 1, x, y) &&
+            image.sameColour(x + 1, y - 1, x, y)) {
+                int side = 1 + std::min({row[x + 1], above[x], above[x + 1]});
+                row[x] = static_cast<uint8_t>(std::min(side, 255));
+            }
+            else {
+                row[x] = 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include "ImageView.hpp"
+#include "ImportArena.hpp"
+
+// the side of the biggest square of one colour at every pixel, worked out in one pass
+// so fitting a square is a single lookup instead of checking every pixel it covers
+class SquareMap {
+public:
+    SquareMap(ImageView image, ImportArena& arena);
+
+    // the square grows right and up from the pixel like the objects do, 0 for see through pixels
+    int side(int x, int y) const { return m_sides[static_cast<size_t>(y) * m_width + x]; }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // bytes a map of this size takes
+    static size_t bytesFor(int width, int height) { return static_cast<size_t>(width) * height; }
+
+private:
+    int m_width;
+    int m_height;
+    // capped at 255, far bigger than any square object
+    ArenaVector<uint8_t> m_sides;
+};
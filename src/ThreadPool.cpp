@@ -0,0 +1,165 @@
+#include "ThreadPool.hpp"
+#include "ImportTrace.hpp"
+
+namespace {
+    // which pool and queue the current thread belongs to
+    thread_local ThreadPool const* t_pool = nullptr;
+    thread_local unsigned t_queueIndex = 0;
+
+    // the pool shared by imports, shutdown destroys it which stops and joins the workers
+    std::mutex s_sharedMutex;
+    std::unique_ptr<ThreadPool> s_sharedPool;
+    unsigned s_sharedLimit = 0;
+}
+
+ThreadPool::ThreadPool(unsigned workerCount) {
+    // the last queue is for tasks submitted from outside the pool
+    for (unsigned i = 0; i <= workerCount; ++i) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    m_threads.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        m_threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    // workers keep their own tasks local, everyone else uses the shared queue
+    unsigned index = t_pool == this ? t_queueIndex : workerCount();
+    {
+        std::lock_guard lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+        m_pending++;
+    }
+    // taking the lock stops a worker missing the wake up between its check and its wait
+    { std::lock_guard lock(m_sleepMutex); }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::runPendingTask() {
+    Task task;
+    unsigned index = t_pool == this ? t_queueIndex : workerCount();
+    if (!takeTask(index, task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+bool ThreadPool::takeTask(unsigned index, Task& task) {
+    // newest task from our own queue first as its data is most likely still cached
+    {
+        auto& own = *m_queues[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_pending--;
+            return true;
+        }
+    }
+    // steal the oldest task from someone else
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        auto& other = *m_queues[(index + offset) % m_queues.size()];
+        std::lock_guard lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            m_pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    t_pool = this;
+    t_queueIndex = index;
+    while (true) {
+        Task task;
+        if (takeTask(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock lock(m_sleepMutex);
+        m_wake.wait(lock, [this] { return m_stopping || m_pending > 0; });
+        // finishes whatever is left before stopping
+        if (m_stopping && m_pending == 0) {
+            return;
+        }
+    }
+}
+
+ThreadPool& ThreadPool::get(unsigned maxThreads) {
+    std::lock_guard lock(s_sharedMutex);
+    if (!s_sharedPool || s_sharedLimit != maxThreads) {
+        unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+        unsigned threads = maxThreads == 0 ? hardware : std::min(hardware, maxThreads);
+        // the importing thread helps out so it counts as one of the threads
+        s_sharedPool.reset();
+        s_sharedPool = std::make_unique<ThreadPool>(threads - 1);
+        s_sharedLimit = maxThreads;
+    }
+    return *s_sharedPool;
+}
+
+void ThreadPool::shutdown() {
+    std::lock_guard lock(s_sharedMutex);
+    s_sharedPool.reset();
+}
+
+void TaskGroup::run(ThreadPool::Task task) {
+    m_remaining++;
+    m_pool.submit([this, task = std::move(task)] {
+        // shows which thread ran what when an import is being traced
+        TraceSpan span("task", "pool");
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard lock(m_errorMutex);
+            if (!m_error) {
+                m_error = std::current_exception();
+            }
+        }
+        // counted down under the lock so the waiter can not return and free the group before
+        // this is done with it
+        std::lock_guard lock(m_doneMutex);
+        if (--m_remaining == 0) {
+            m_done.notify_all();
+        }
+    });
+}
+
+void TaskGroup::finish() {
+    // helps out instead of blocking so waiting from a worker cant deadlock
+    while (m_remaining > 0 && m_pool.runPendingTask()) {
+    }
+    // nothing is queued so every task left is running on another thread, it sleeps until they are done
+    std::unique_lock lock(m_doneMutex);
+    m_done.wait(lock, [this] { return m_remaining == 0; });
+}
+
+void TaskGroup::wait() {
+    finish();
+    std::exception_ptr error;
+    {
+        std::lock_guard lock(m_errorMutex);
+        std::swap(error, m_error);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
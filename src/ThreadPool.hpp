@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work stealing thread pool that the importer splits its work across
+// every worker owns a queue, it takes from the back of its own queue
+// and steals from the front of the others when it runs out
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // makes a pool with the given amount of worker threads
+    // the thread that waits on work also runs tasks so 0 workers is allowed
+    explicit ThreadPool(unsigned workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // amount of worker threads
+    unsigned workerCount() const { return static_cast<unsigned>(m_threads.size()); }
+    // amount of threads that work on a parallel loop, including the caller
+    unsigned concurrency() const { return workerCount() + 1; }
+
+    // queues a task, workers push to their own queue so it stays hot
+    // tasks must not throw, use a TaskGroup if they can
+    void submit(Task task);
+    // runs one queued task on the calling thread, returns false if there was none
+    bool runPendingTask();
+
+    // calls func(chunkBegin, chunkEnd) for chunks of [begin, end) on the pool
+    // and returns once every chunk is done, rethrowing the first exception
+    template <typename Func>
+    void parallelFor(size_t begin, size_t end, size_t grain, Func&& func);
+
+    // gets the pool shared by every import, it is made on first use and
+    // remade if the thread limit changed since then (0 means no limit)
+    static ThreadPool& get(unsigned maxThreads);
+    // stops and joins the shared pool, the mod calls it when it unloads once nothing is
+    // importing, the next get makes a new one
+    static void shutdown();
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(unsigned index);
+    // pops from the given queue first and then tries to steal from the rest
+    bool takeTask(unsigned index, Task& task);
+
+    // one queue per worker plus one for threads outside the pool
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_pending{0};
+    std::atomic<bool> m_stopping{false};
+};
+
+// keeps track of a set of tasks so they can be waited on together
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : m_pool(pool) {}
+    ~TaskGroup() { finish(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(ThreadPool::Task task);
+    // helps run queued tasks until every task in the group is done
+    // then rethrows the first exception one of them threw
+    void wait();
+
+private:
+    void finish();
+
+    ThreadPool& m_pool;
+    std::atomic<size_t> m_remaining{0};
+    // the last task to finish wakes up whoever is waiting
+    std::mutex m_doneMutex;
+    std::condition_variable m_done;
+    std::mutex m_errorMutex;
+    std::exception_ptr m_error;
+};
+
+template <typename Func>
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, Func&& func) {
+    if (begin >= end) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    // not worth splitting so just run it here
+    if (end - begin <= grain || m_threads.empty()) {
+        func(begin, end);
+        return;
+    }
+    TaskGroup group(*this);
+    for (size_t chunk = begin; chunk < end; chunk += grain) {
+        size_t chunkEnd = std::min(end, chunk + grain);
+        group.run([&func, chunk, chunkEnd] { func(chunk, chunkEnd); });
+    }
+    group.wait();
+}
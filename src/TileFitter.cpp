@@ -0,0 +1,102 @@
+#include "FitStrategies.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "ThreadPool.hpp"
+
+using namespace objects;
+
+namespace {
+    // bands are always this many rows so the objects come out the same however many threads
+    // there are, and the quadtree's nodes never cross a seam
+    constexpr int tileRows = 128;
+
+    // the objects of one band, in image rows
+    struct TileResult {
+        std::vector<ObjectRecord> records;
+        FitReport report;
+    };
+
+    // joins objects that meet across the seam above lowerTop, the lower one grows up over the
+    // upper one, which is left with no height so it gets skipped
+    // only objects with the same x and width line up, shapes the seam cut differently stay as two
+    // objects, fitting the rows around each seam again gets most of them back but takes longer
+    // than fitting the whole image on one thread so it is not done
+    void stitchSeam(std::vector<ObjectRecord>& upper, std::vector<ObjectRecord>& lower, int lowerTop) {
+        // objects on one layer never overlap, so only one can end at the seam at each column
+        std::unordered_map<uint64_t, size_t> endingAbove;
+        for (size_t i = 0; i < upper.size(); ++i) {
+            auto const& record = upper[i];
+            if (record.height > 0 && record.y == lowerTop - 1) {
+                endingAbove.emplace((static_cast<uint64_t>(record.layer) << 32) | static_cast<uint32_t>(record.x), i);
+            }
+        }
+        for (auto& record : lower) {
+            if (record.y - record.height + 1 != lowerTop || record.objectID != pixelObjID) {
+                continue;
+            }
+            auto found = endingAbove.find((static_cast<uint64_t>(record.layer) << 32) |
+                static_cast<uint32_t>(record.x));
+            if (found == endingAbove.end()) {
+                continue;
+            }
+            auto& above = upper[found->second];
+            if (above.objectID == pixelObjID && above.width == record.width && above.colour == record.colour &&
+                record.height + above.height <= maxStretchPixels) {
+                record.height += above.height;
+                above.height = 0;
+            }
+        }
+    }
+}
+
+Generator<ObjectRecord> fitting::fitTiles(ImageView image, FitSettings settings, FitReport& report,
+    ImportArena&) {
+    int bands = (image.height + tileRows - 1) / tileRows;
+    std::vector<TileResult> tiles(bands);
+    auto bandSettings = settings;
+    bandSettings.parallelTiles = false;
+    // the bands are what runs at once, so they fit on their own
+    bandSettings.pool = nullptr;
+    auto fitBands = [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            int top = static_cast<int>(band) * tileRows;
+            int rows = std::min(tileRows, image.height - top);
+            // rows are stored one after another so a band is just an offset into the image
+            ImageView bandView{image.pixel(0, top), image.width, rows, image.channels};
+            ImportArena bandArena;
+            auto& tile = tiles[band];
+            for (auto record : fitArt(bandView, bandSettings, tile.report, bandArena)) {
+                record.y += top;
+                tile.records.push_back(record);
+            }
+        }
+    };
+    if (settings.pool) {
+        settings.pool->parallelFor(0, bands, 1, fitBands);
+    }
+    else {
+        fitBands(0, bands);
+    }
+
+    // top seam first so objects joined at one seam can be joined again at the next
+    for (int band = 0; band + 1 < bands; ++band) {
+        stitchSeam(tiles[band].records, tiles[band + 1].records, (band + 1) * tileRows);
+    }
+    for (auto const& tile : tiles) {
+        // every band runs at once so the rows that fell back are spread out, this is how many there were
+        if (tile.report.pastDeadline) {
+            report.pastDeadline = true;
+            report.fallbackRows += tile.report.fallbackRows;
+        }
+        report.fallbackRegions += tile.report.fallbackRegions;
+    }
+    // bottom band first like the other modes
+    for (int band = bands - 1; band >= 0; --band) {
+        for (auto const& record : tiles[band].records) {
+            if (record.height > 0) {
+                co_yield record;
+            }
+        }
+    }
+}
@@ -0,0 +1,208 @@
+#include "TiledImport.hpp"
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include "Colour.hpp"
+#include "ImportArena.hpp"
+#include "ImportTrace.hpp"
+#include "ObjectStore.hpp"
+#include "PixelMask.hpp"
+#include "SquareMap.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+    // bands need to be at least as tall as the biggest square
+    constexpr int minBandHeight = 6;
+    constexpr size_t minBatchRecords = 1024;
+
+    // how an object is kept in the record file
+    struct SpilledObject {
+        uint16_t objectID;
+        uint16_t x;
+        uint16_t y;
+        uint16_t width;
+        uint16_t height;
+        // fits in the padding so spilled records stay the same size
+        uint8_t layer;
+        uint32_t colour;
+    };
+
+    // rough memory one object needs while it is being inserted, including its text
+    constexpr size_t bytesPerInsertedObject = sizeof(SpilledObject) + ObjectStore::bytesPerObject + 256;
+
+    // temporary file that is deleted once it is not needed
+    class SpillFile {
+    public:
+        explicit SpillFile(std::filesystem::path path) : m_path(std::move(path)) {
+            m_file.open(m_path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+            if (!m_file) {
+                throw std::runtime_error("Could not create the temporary file " + m_path.string());
+            }
+        }
+
+        ~SpillFile() {
+            m_file.close();
+            std::error_code error;
+            std::filesystem::remove(m_path, error);
+        }
+
+        void write(void const* data, size_t size) {
+            m_file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+            if (!m_file) {
+                throw std::runtime_error("Could not write to " + m_path.string() + ", is the disk full?");
+            }
+        }
+
+        void read(size_t offset, void* data, size_t size) {
+            m_file.seekg(static_cast<std::streamoff>(offset));
+            m_file.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+            if (!m_file) {
+                throw std::runtime_error("Could not read back " + m_path.string());
+            }
+        }
+
+    private:
+        std::filesystem::path m_path;
+        std::fstream m_file;
+    };
+}
+
+TiledReport importTiled(ImageView image, std::function<void()> const& releaseImage, FitSettings settings,
+    TiledSettings const& tiled, ArtOrigin origin, ThreadPool& pool, InsertBatch const& insert) {
+    TiledReport report;
+    size_t rowBytes = static_cast<size_t>(image.width) * image.channels;
+    // half the budget goes to the band, a row costs its pixels, its placed bits and its square sides
+    size_t rowCost = rowBytes + image.width / 8 + 1 + SquareMap::bytesFor(image.width, 1);
+    report.bandHeight = static_cast<int>(std::clamp<size_t>(tiled.memoryBudget / 2 / rowCost,
+        minBandHeight, std::max(image.height, minBandHeight)));
+    report.bandCount = (image.height + report.bandHeight - 1) / report.bandHeight;
+    // each band is fitted on its own so they share the object budget
+    if (settings.objectBudget > 0) {
+        settings.objectBudget = std::max<size_t>(1, settings.objectBudget / report.bandCount);
+    }
+    // the other half goes to the records waiting to be written or inserted
+    size_t batchRecords = std::max(minBatchRecords, tiled.memoryBudget / 2 / bytesPerInsertedObject);
+
+    // bands are whole rows so each one is a single block of the image
+    SpillFile tiles(tiled.spillDir / "import-tiles.tmp");
+    {
+        StageTimer timer(report.stats.spillSeconds);
+        StageMemoryMeter meter(report.stats.spillMemory);
+        TraceSpan span("spill image", "tiled", {"bands", report.bandCount}, {"band rows", report.bandHeight});
+        for (int band = 0; band < report.bandCount; ++band) {
+            int top = band * report.bandHeight;
+            int rows = std::min(report.bandHeight, image.height - top);
+            tiles.write(image.pixel(0, top), rows * rowBytes);
+        }
+        // nothing needs the decoded image after this
+        releaseImage();
+    }
+    // the whole image is only in memory until it is spilled, then it is one band at a time
+    report.stats.imageBytes = static_cast<size_t>(image.height) * rowBytes;
+    report.stats.placedBytes = PixelMask::bytesFor(image.width, report.bandHeight) +
+        SquareMap::bytesFor(image.width, report.bandHeight);
+
+    SpillFile recordFile(tiled.spillDir / "import-records.tmp");
+    std::vector<unsigned char> bandPixels(report.bandHeight * rowBytes);
+    std::vector<SpilledObject> pending;
+    pending.reserve(batchRecords);
+    // the batches each have their own colours so the import wide count is kept here, one bit for
+    // every rgb colour is 2 MB however big the image is, a set of the colours seen would grow past
+    // that on a photo and could not be planned for
+    std::vector<uint64_t> seenColours((size_t(1) << 24) / 64);
+    size_t uniqueColours = 0;
+    auto flush = [&] {
+        recordFile.write(pending.data(), pending.size() * sizeof(SpilledObject));
+        pending.clear();
+    };
+    // goes bottom to top like the normal import
+    for (int band = report.bandCount - 1; band >= 0; --band) {
+        int top = band * report.bandHeight;
+        int rows = std::min(report.bandHeight, image.height - top);
+        TraceSpan bandSpan("band", "tiled", {"band", band}, {"rows", rows});
+        {
+            StageTimer timer(report.stats.spillSeconds);
+            TraceSpan span("read band", "tiled");
+            tiles.read(top * rowBytes, bandPixels.data(), rows * rowBytes);
+        }
+        StageTimer timer(report.stats.fittingSeconds);
+        TraceSpan fitSpan("fit band", "fit", {"band", band});
+        ImageView bandView{bandPixels.data(), image.width, rows, image.channels};
+        report.stats.pixels += countOpaquePixels(bandView);
+        // each band gets its own arena so its placed grid is freed straight after
+        ImportArena arena;
+        StageMemoryMeter meter(report.stats.fittingMemory, &arena);
+        FitReport bandReport;
+        for (auto record : fitArt(bandView, settings, bandReport, arena)) {
+            pending.push_back(SpilledObject{static_cast<uint16_t>(record.objectID),
+                static_cast<uint16_t>(record.x), static_cast<uint16_t>(record.y + top),
+                static_cast<uint16_t>(record.width), static_cast<uint16_t>(record.height),
+                static_cast<uint8_t>(record.layer), record.colour});
+            uint64_t bit = uint64_t(1) << (record.colour % 64);
+            auto& word = seenColours[record.colour / 64];
+            if (!(word & bit)) {
+                word |= bit;
+                uniqueColours++;
+            }
+            report.objectCount++;
+            if (pending.size() == batchRecords) {
+                flush();
+            }
+        }
+        // the first band to run out of time is where the fallback starts
+        if (bandReport.pastDeadline && !report.fit.pastDeadline) {
+            report.fit.pastDeadline = true;
+            report.fit.fallbackRows = top + bandReport.fallbackRows;
+        }
+        report.fit.fallbackRegions += bandReport.fallbackRegions;
+        report.fit.coloursMerged = report.fit.coloursMerged || bandReport.coloursMerged;
+        report.fit.overBudget = report.fit.overBudget || bandReport.overBudget;
+        report.fit.colourError += bandReport.colourError;
+        report.fit.colourPixels += bandReport.colourPixels;
+    }
+    flush();
+    bandPixels = {};
+    seenColours = {};
+    report.stats.uniqueColours = uniqueColours;
+
+    // streams the records back a batch at a time
+    std::vector<SpilledObject> batch(std::min(batchRecords, report.objectCount));
+    for (size_t first = 0; first < report.objectCount; first += batchRecords) {
+        size_t count = std::min(batchRecords, report.objectCount - first);
+        ImportArena arena;
+        ObjectStore objects(arena);
+        std::optional<ArenaString> levelString;
+        TraceSpan batchSpan("batch", "tiled", {"batch", report.batchCount},
+            {"objects", static_cast<int64_t>(count)});
+        {
+            StageTimer timer(report.stats.serializeSeconds);
+            StageMemoryMeter meter(report.stats.serializeMemory, &arena);
+            TraceSpan span("write batch", "serialize");
+            recordFile.read(first * sizeof(SpilledObject), batch.data(), count * sizeof(SpilledObject));
+            objects.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                auto const& spilled = batch[i];
+                objects.push(ObjectRecord{spilled.objectID, spilled.x, spilled.y, spilled.width,
+                    spilled.height, spilled.colour, spilled.layer});
+            }
+            ColourPalette palette(objects.colours(), pool, arena);
+            levelString = buildLevelString(objects, origin, palette, pool, arena);
+        }
+        report.stats.countObjects(objects);
+        report.stats.bytesEmitted += levelString->size();
+        report.stats.objectStoreBytes = std::max(report.stats.objectStoreBytes, objects.memoryBytes());
+        // the chunks and the joined string are alive at the same time
+        report.stats.stringBytes = std::max(report.stats.stringBytes, levelString->size() * 2);
+        {
+            StageTimer timer(report.stats.insertSeconds);
+            StageMemoryMeter meter(report.stats.insertMemory);
+            TraceSpan span("insert batch", "insert");
+            insert(levelString->c_str());
+        }
+        report.batchCount++;
+    }
+    return report;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include "ArtFitter.hpp"
+#include "ImageView.hpp"
+#include "ImportStats.hpp"
+#include "LevelString.hpp"
+
+class ThreadPool;
+
+// settings for importing an image one band of rows at a time
+struct TiledSettings {
+    // where the temporary files go
+    std::filesystem::path spillDir;
+    // roughly how much memory the band and the insert batches can use, the colour count takes
+    // another 2 MB on top
+    size_t memoryBudget = 64 * 1024 * 1024;
+};
+
+struct TiledReport {
+    FitReport fit;
+    int bandHeight = 0;
+    int bandCount = 0;
+    size_t objectCount = 0;
+    int batchCount = 0;
+    ImportStats stats;
+};
+
+// adds a batch of objects to the level, the string is in the
+// createObjectsFromString format
+using InsertBatch = std::function<void(char const* levelString)>;
+
+// spills the image to a temporary file in bands of rows and fits one band
+// at a time, writing the records to a second file, then streams the records
+// back to insert in batches so memory stays flat however big the image is
+// releaseImage gets called once the image is on disk so it can be freed
+TiledReport importTiled(ImageView image, std::function<void()> const& releaseImage, FitSettings settings,
+    TiledSettings const& tiled, ArtOrigin origin, ThreadPool& pool, InsertBatch const& insert);
@@ -17,8 +17,29 @@
 #include <cmath>
 #include <utility>
 #include <stdexcept>
+#include <unordered_map>
+#include <chrono>
+#include <optional>
+#include <memory>
+#include "ImportStats.hpp"
+// counts what the decoder allocates for the import stats
+#define STBI_MALLOC(size) countedMalloc(size)
+#define STBI_REALLOC(pointer, size) countedRealloc(pointer, size)
+#define STBI_FREE(pointer) std::free(pointer)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "ArtFitter.hpp"
+#include "ArtRefiner.hpp"
+#include "Colour.hpp"
+#include "ImportArena.hpp"
+#include "ImportTrace.hpp"
+#include "MemoryBudget.hpp"
+#include "LevelString.hpp"
+#include "ObjectStore.hpp"
+#include "PixelMask.hpp"
+#include "SquareMap.hpp"
+#include "ThreadPool.hpp"
+#include "TiledImport.hpp"
 
 using namespace geode::prelude;
 
@@ -37,37 +58,17 @@ class $modify(MyEditorUI, EditorUI) {
     struct Fields {
         GameObject* m_object = nullptr;
         std::vector<std::vector<bool>> containsPixelObject;
+        // looks for a fit with fewer objects after a quick import
+        std::unique_ptr<ArtRefiner> m_refiner;
+        // the objects of the art that is being refined, and the undo and redo history when they went in
+        Ref<CCArray> m_artObjects;
+        unsigned int m_undoCount = 0;
+        CCObject* m_lastUndo = nullptr;
+        unsigned int m_redoCount = 0;
+        CCObject* m_lastRedo = nullptr;
+        // objects in the last fit that was swapped in, 0 until there is one
+        size_t m_refinedObjects = 0;
     };
-private:
-    // object IDs for various object sizes
-    static constexpr int pixelObjID = 3097;
-    static constexpr int medPixelObjID = 3094;
-    static constexpr int bigPixelObjID = 3093;
-    static constexpr int largePixelObjID = 3092;
-
-    // object ID of old pixel object
-    static constexpr int oldPixelObjID = 917;
-
-    // black color channel
-    static constexpr int colourChannel = 1010;
-
-    // z order layering
-    static constexpr int zOrder = 1;
-
-    // size of the objects
-    static constexpr float objSize = 5.0f;
-
-    // scale used for moving between pixels
-    static constexpr float scale = 5;
-
-    struct OWOShape {
-        std::vector<std::pair<int, int>> offsets;
-        int id;
-    };
-
-    // initialize the objects, pls dont question the name
-    static const std::vector<OWOShape> OWOshapes;
-
 public:
     struct Pixel {
         uint8_t blue;
@@ -102,8 +103,87 @@ public:
         return imageData;
     }
     
+    // both histories still end where they did when the art went in, so nothing in them points at
+    // the art, an edit that was undone leaves the undo history as it was but adds a redo step
+    bool undoHistoryUnchanged() {
+        auto* undoObjects = LevelEditorLayer::get()->m_undoObjects;
+        auto* redoObjects = LevelEditorLayer::get()->m_redoObjects;
+        return undoObjects->count() == m_fields->m_undoCount && undoObjects->lastObject() == m_fields->m_lastUndo &&
+            redoObjects->count() == m_fields->m_redoCount && redoObjects->lastObject() == m_fields->m_lastRedo;
+    }
+
+    // starts looking for a fit with fewer objects than the art that was just put in
+    void startRefining(CCArray* artObjects, std::unique_ptr<ArtRefiner> refiner) {
+        auto* undoObjects = LevelEditorLayer::get()->m_undoObjects;
+        auto* redoObjects = LevelEditorLayer::get()->m_redoObjects;
+        m_fields->m_artObjects = artObjects;
+        m_fields->m_undoCount = undoObjects->count();
+        m_fields->m_lastUndo = undoObjects->lastObject();
+        m_fields->m_redoCount = redoObjects->count();
+        m_fields->m_lastRedo = redoObjects->lastObject();
+        m_fields->m_refinedObjects = 0;
+        m_fields->m_refiner = std::move(refiner);
+        this->schedule(schedule_selector(MyEditorUI::updateRefining), 0.25f);
+    }
+
+    // swaps in anything better the refiner found since last time
+    void updateRefining(float) {
+        auto& refiner = m_fields->m_refiner;
+        if (!refiner) {
+            this->unschedule(schedule_selector(MyEditorUI::updateRefining));
+            return;
+        }
+        // checked first so a fit found right at the end is still taken below
+        bool finished = refiner->finished();
+        if (auto improvement = refiner->takeImprovement()) {
+            // the objects can only go if nothing the user did since can bring them back
+            if (!undoHistoryUnchanged()) {
+                // it is only cleaned up once it finishes so the game does not wait on the fit going on
+                log::info("Stopped refining as the level was edited");
+                refiner->stop();
+            }
+            else {
+                auto* editorLayer = LevelEditorLayer::get();
+                // all in one frame and without undo steps, so it is as if it was imported like this
+                for (auto* object : CCArrayExt<GameObject*>(m_fields->m_artObjects)) {
+                    editorLayer->removeObject(object, true);
+                }
+                m_fields->m_artObjects = editorLayer->createObjectsFromString(improvement->levelString.c_str(),
+                true, true);
+                m_fields->m_refinedObjects = improvement->objects;
+                log::info("Refined the art to {} objects with the {} mode", improvement->objects,
+                fitModeName(improvement->mode));
+            }
+        }
+        if (finished) {
+            if (m_fields->m_refinedObjects > 0) {
+                Notification::create(fmt::format("Refined the art down to {} objects", m_fields->m_refinedObjects),
+                NotificationIcon::Success)->show();
+            }
+            refiner.reset();
+            m_fields->m_artObjects = nullptr;
+            this->unschedule(schedule_selector(MyEditorUI::updateRefining));
+        }
+    }
+
     // triggered when button is clicked
     void onPixelArtImport(CCObject*) {
+        // the button stops refining while it is going on
+        if (m_fields->m_refiner) {
+            geode::createQuickPopup(
+                "Refining art",
+                fmt::format("The last import is still looking for fewer objects, it is down to <cy>{}</c> so far.\n"
+                "Stop refining?", m_fields->m_refiner->bestObjects()),
+                "Keep going", "Stop",
+                [this](auto, bool btn2) {
+                    if (btn2 && m_fields->m_refiner) {
+                        // the next update sees it finish and cleans up
+                        m_fields->m_refiner->stop();
+                    }
+                }
+            );
+            return;
+        }
         // check if exactly one object is selected
         if(this->getSelectedObjects()->count() == 1) {
             // asks for a png
@@ -143,6 +223,8 @@ public:
     }
 
     void CreateArt(const std::string& path) {
+        // the import has to finish the optimised part within the time limit
+        auto importStart = std::chrono::steady_clock::now();
         int height;
         int channels;
         int width;
@@ -152,14 +234,20 @@ public:
         m_fields->m_object = object;
         float startX = object->getPositionX();
         float startY = object->getPositionY();
-        // holds the added object in string format
-        std::ostringstream objInLevel;
-        std::string objString;
+        // holds everything the import needs until it is done, freed all at once at the end
+        ImportArena arena;
+        FitReport report;
+        ImportStats stats;
+        // records what every thread did when tracing is turned on
+        std::optional<ImportTrace> trace;
+        if (Mod::get()->getSettingValue<bool>("Trace-imports")) {
+            trace.emplace();
+        }
+        ScopedTrace activeTrace(trace ? &*trace : nullptr);
         try {
-            // gets image data
-            data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-            // checks if the image data was fetched
-            if (!data) {
+            TraceSpan importSpan("import", "stage");
+            // reads the size without decoding the image
+            if (!stbi_info(path.c_str(), &width, &height, &channels)) {
                 throw std::runtime_error("Failed to load image.");
             }
             // gets the settings 
@@ -167,222 +255,175 @@ public:
             auto useScaling = Mod::get()->getSettingValue<bool>("Enable-Scale");
             auto useBasicOpt = Mod::get()->getSettingValue<bool>("Enable-Basic-optimise");
             auto useOldObject = Mod::get()->getSettingValue<bool>("Use-OlderObjects");
-            // sets the pixel object id
-            int currentObjID = pixelObjID;
-            if(useOldObject){
-                currentObjID = oldPixelObjID;
-            }
+            auto timeLimit = Mod::get()->getSettingValue<int64_t>("Import-time-limit");
+            auto useTiled = Mod::get()->getSettingValue<bool>("Tiled-import");
+            auto fittingMode = fitModeFromName(Mod::get()->getSettingValue<std::string>("Fitting-mode"));
+            auto objectBudget = Mod::get()->getSettingValue<int64_t>("Object-budget");
+            auto refineTime = Mod::get()->getSettingValue<int64_t>("Refine-time-limit");
+            auto parallelTiles = Mod::get()->getSettingValue<bool>("Parallel-tiles");
             // checks the size or if the size limit is on
-            if ((width * height > 40000) && !sizeLimitValue) {
+            if ((static_cast<long long>(width) * height > 40000) && !sizeLimitValue) {
                 throw std::runtime_error(
                 "Image cannot be bigger than 200 by 200. Change this in the settings for this mod.");
             }
-            // contains the pixels that have been placed
-            std::vector<std::vector<bool>> placed(height, std::vector<bool>(width, false));
-            // loops through image data
-            for (int y = height - 1; y >= 0; --y) {
-                for (int x = 0; x < width;) {
-                    // gets the index for the current pixel being looked at
-                    int pixelIndex = (y * width + x) * channels;
-                    // gets alpha amd checks if there is a pixel
-                    uint8_t alpha = (channels == 4) ? data[pixelIndex + 3] : 255;
-                    if (placed[y][x] || alpha == 0) {
-                        x++;
-                        continue;
-                    }
-                    int xStretch = 0;
-                    int yStretch = 0;
-                    // checks if the old pixel is not being used or basic op is on
-                    if(useBasicOpt && !useOldObject){
-                        // sets a target colour for comparing
-                        uint8_t targetColour[3] = {data[pixelIndex], data[pixelIndex + 1], 
-                                data[pixelIndex + 2]};
-                        // loops through the different shapes (these represent GD objects)
-                        for (const auto& shape : OWOshapes){
-                            bool canPlace = true;
-                            // goes through the possible locations these shapes could fit
-                            for (const auto& offset : shape.offsets){
-                                int newX = x + offset.first;
-                                int newY = y - offset.second;
-                                // makes sure its not out of bounds
-                                if (newY < 0 || newY >= height || newX < 0 || newX >= width) {
-                                    canPlace = false;
-                                    break;
-                                }
-                                // makes a new pixel index for the pixel being compared
-                                int newPixelIndex = (newY * width + newX) * channels;
-                                uint8_t newAlpha = (channels == 4) ? data[newPixelIndex + 3] : 255;
-                                // checks if the new pixel is the same colour as the original pixel
-                                if (data[newPixelIndex] != targetColour[0] ||
-                                data[newPixelIndex + 1] != targetColour[1] ||
-                                data[newPixelIndex + 2] != targetColour[2] ||
-                                newAlpha == 0) {
-                                    canPlace = false;
-                                    break;
-                                }
-                            }
-                            // checks if scale opt is checked or the shape is 0
-                            if (shape.id == 0 && canPlace && useScaling) {
-                                // new pixel indexes for the pixels offset y and x direction
-                                int tempPixelIndexX = (y * width + x + 1) * channels;
-                                int tempPixelIndexY = ((y - 1) * width + x) * channels;
-                                // prioritises x over y
-                                if(data[tempPixelIndexX] == targetColour[0] 
-                                && data[tempPixelIndexX + 1] == targetColour[1] 
-                                && data[tempPixelIndexX + 2] == targetColour[2] 
-                                && !placed[y][x + 1]){
-                                    for (int currentX = x; currentX < width; ++currentX) {
-                                        int currentPixelIndex = (y * width + currentX) * channels;
-                                        uint8_t newAlpha = (channels == 4) ? data[currentPixelIndex + 3] : 255;
-                                        if (data[currentPixelIndex] == targetColour[0] &&
-                                            data[currentPixelIndex + 1] == targetColour[1] &&
-                                            data[currentPixelIndex + 2] == targetColour[2] &&
-                                            !placed[y][currentX] && newAlpha != 0) {
-                                            xStretch++;
-                                            placed[y][currentX] = true;
-                                        } else {
-                                            break;
-                                        }
-                                    }
-                                }else if(data[tempPixelIndexY] == targetColour[0] 
-                                && data[tempPixelIndexY + 1] == targetColour[1] 
-                                && data[tempPixelIndexY + 2] == targetColour[2] 
-                                && !placed[y - 1][x]){
-                                    for (int currentY = y; currentY >= 0; --currentY) {
-                                        int currentPixelIndex = (currentY * width + x) * channels;
-                                        uint8_t newAlpha = (channels == 4) ? 
-                                                data[currentPixelIndex + 3] : 255;
-                                        if (data[currentPixelIndex] == targetColour[0] &&
-                                            data[currentPixelIndex + 1] == targetColour[1] &&
-                                            data[currentPixelIndex + 2] == targetColour[2] &&
-                                            !placed[currentY][x] && newAlpha != 0) {
-                                            yStretch++;
-                                            placed[currentY][x] = true;
-                                        } else {
-                                            break;
-                                        }
-                                    }
-                                }
-                                // does the same checks but for the second shape
-                            }else if(shape.id == 1 && canPlace && useScaling){
-                                // this section doesnt work so just ignore it
-                                bool stretchX = true;
-                                for (int i = 0; i <= 1; ++i) {
-                                    int pixelIndexX = ((y - i) * width + x + 3) * channels;
-                                    if (!(data[pixelIndexX] == targetColour[0] &&
-                                        data[pixelIndexX + 1] == targetColour[1] &&
-                                        data[pixelIndexX + 2] == targetColour[2]) ||
-                                        placed[y - i][x + 3]) {
-                                        stretchX = false;
-                                        break;
-                                    }
-                                    else{
-                                        placed[y - i][x + 3] = true;
-                                        xStretch++;
-                                    }
-                                }
-                                if(stretchX){
-                                    for (int offsetX = 4; offsetX < width - x; ++offsetX) {
-                                        bool rowMatch = true;
-                                        for (int i = 0; i <= 1; ++i) {
-                                            int pixelIndexX = ((y - i) * width + x + offsetX) * channels;
-                                            if (!(data[pixelIndexX] == targetColour[0] &&
-                                            data[pixelIndexX + 1] == targetColour[1] &&
-                                            data[pixelIndexX + 2] == targetColour[2]) ||
-                                            placed[y - i][x + offsetX]) {
-                                                rowMatch = false;
-                                                break;
-                                            }
-                                            else{
-                                                placed[y - i][x + offsetX] = true;
-                                            }
-                                        }
-                                        if(rowMatch == false){
-                                            break;
-                                        }
-                                        else{
-                                            xStretch++;
-                                        }
-                                    }
-                                }
-                            }
-                            // checks if an object can be placed
-                            if (canPlace) {
-                                // formats the colours so they are GD format
-                                std::string objColour = formatHsvToString(data[pixelIndex], 
-                                            data[pixelIndex + 1], data[pixelIndex + 2]);
-                                // for the scaling based opt it sets the offsets as true if they exist
-                                for (const auto& offset : shape.offsets) {
-                                    placed[y - offset.second][x + offset.first] = true;
-                                }
-                                // gets the current object id depending the shape
-                                currentObjID = shape.id == 1 ? medPixelObjID : (shape.id == 2 ? 
-                                bigPixelObjID : (shape.id == 3 ? largePixelObjID : pixelObjID));
-                                // figures out the scale
-                                float currentScale = shape.id == 1 ? 2.5f : (shape.id == 2 ? 5.0f : 
-                                (shape.id == 3 ? 12.5f : 0));
-                                // calculates the size
-                                int currentSize = objSize * (shape.id + 1);
-                                // shape 3 is much bigger than the others so I set it here
-                                if(shape.id == 3){
-                                    currentSize = 30;
-                                }
-                                // for the scaling I calculated the x and y scale
-                                float currentXSize = currentSize * xStretch;
-                                float currentYSize = currentSize * yStretch;
-                                // checks if stretching has occured on x
-                                if(xStretch > 0){
-                                    objInLevel << "1," << currentObjID << ",2," << ((startX + x * scale + currentScale) + 
-                                    (xStretch * 0.5 * scale - 2.5f)) << ",3," <<
-                                    (startY - y * scale + currentScale) << ",21," << colourChannel <<
-                                    ",41,1,43," << objColour << ",25," << zOrder << ",128," << 
-                                    currentXSize  << ",129," << currentSize << ";";
-                                }
-                                // checks if stretching has occured on y
-                                else if(yStretch > 0){
-                                    objInLevel << "1," << currentObjID << ",2," << 
-                                    (startX + x * scale + currentScale) << ",3," << ((startY - y * scale + currentScale)
-                                     + (yStretch * 0.5 * scale - 2.5f)) << ",21," << colourChannel << ",41,1,43," 
-                                     << objColour << ",25," << zOrder << ",128," << currentSize  
-                                     << ",129," << currentYSize << ";";
-                                }
-                                // No stretching
-                                else{
-                                    objInLevel << "1," << currentObjID << ",2," << (startX + x * scale + currentScale) 
-                                    << ",3," << (startY - y * scale + currentScale) << ",21," << colourChannel <<
-                                    ",41,1,43," << objColour << ",25," << zOrder << ",32," << currentSize << ";";
-                                }
-                                break;
-                            }
-                        }
+            // objects store their positions in 16 bits
+            if (width > ObjectStore::maxCoordinate || height > ObjectStore::maxCoordinate) {
+                throw std::runtime_error(fmt::format("Image cannot be wider or taller than {} pixels.",
+                ObjectStore::maxCoordinate));
+            }
+            // picks how to import from the memory that is free right now
+            auto memoryPlan = planImportMemory(width, height, channels, availableMemory());
+            log::debug("Import needs up to {} bytes in memory, budget is {} bytes",
+            memoryPlan.inMemoryBytes, memoryPlan.budget);
+            if (memoryPlan.strategy == MemoryPlan::Strategy::Refuse) {
+                throw std::runtime_error(fmt::format(
+                "There is not enough free memory to import this image.\n"
+                "It needs at least <cy>{} MB</c> but only <cy>{} MB</c> can be used safely.",
+                memoryPlan.minimumBytes / (1024 * 1024), memoryPlan.budget / (1024 * 1024)));
+            }
+            // too big to keep in memory so it is done in tiles instead
+            bool tiledForMemory = memoryPlan.strategy == MemoryPlan::Strategy::Tiled && !useTiled;
+            if (memoryPlan.strategy == MemoryPlan::Strategy::Tiled) {
+                useTiled = true;
+            }
+            // gets image data
+            {
+                StageTimer timer(stats.decodeSeconds);
+                StageMemoryMeter meter(stats.decodeMemory);
+                TraceSpan span("decode", "stage");
+                data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+            }
+            // checks if the image data was fetched
+            if (!data) {
+                throw std::runtime_error("Failed to load image.");
+            }
+            // gets the thread pool, it is only made on the first import
+            auto maxThreads = Mod::get()->getSettingValue<int64_t>("Max-threads");
+            auto& pool = ThreadPool::get(static_cast<unsigned>(std::max<int64_t>(maxThreads, 0)));
+            ImageView image{data, width, height, channels};
+            FitSettings settings;
+            settings.optimise = useBasicOpt;
+            settings.useScaling = useScaling;
+            settings.useOldObject = useOldObject;
+            settings.mode = fittingMode.value_or(FitMode::Squares);
+            settings.pool = &pool;
+            settings.parallelTiles = parallelTiles;
+            if (settings.mode == FitMode::Budget) {
+                settings.objectBudget = static_cast<size_t>(std::max<int64_t>(objectBudget, 1));
+            }
+            if (timeLimit > 0) {
+                settings.deadline = importStart + std::chrono::seconds(timeLimit);
+            }
+            // tiled imports go in batches so there is not one set of objects to swap out
+            std::vector<FitMode> refineModes;
+            if (refineTime > 0 && !useTiled) {
+                refineModes = refinementModes(settings);
+            }
+            // puts the quickest mode in first and leaves the picked one to the refiner
+            auto refineSettings = settings;
+            if (!refineModes.empty()) {
+                settings.mode = FitMode::Runs;
+            }
+            ArtOrigin origin{startX, startY};
+            auto editorLayer = LevelEditorLayer::get();
+            // keeps most of the image on disk and adds the objects in batches
+            if (useTiled) {
+                TiledSettings tiled;
+                tiled.spillDir = Mod::get()->getSaveDir();
+                if (memoryPlan.tiledBudget > 0) {
+                    tiled.memoryBudget = std::min(tiled.memoryBudget, memoryPlan.tiledBudget);
+                }
+                TraceSpan span("tiled import", "stage");
+                auto tiledReport = importTiled(image, [&] {
+                    stbi_image_free(data);
+                    data = nullptr;
+                }, settings, tiled, origin, pool, [&](char const* levelString) {
+                    editorLayer->createObjectsFromString(levelString, true, true);
+                });
+                if (tiledReport.objectCount == 0) {
+                    throw std::runtime_error("The image does not have any visible pixels.");
+                }
+                report = tiledReport.fit;
+                tiledReport.stats.decodeSeconds = stats.decodeSeconds;
+                tiledReport.stats.decodeMemory = stats.decodeMemory;
+                stats = tiledReport.stats;
+                log::debug("Tiled import used {} bands of {} rows and {} batches",
+                tiledReport.bandCount, tiledReport.bandHeight, tiledReport.batchCount);
+            }
+            else {
+                // collects the objects as the fitter makes them
+                ObjectStore objects(arena);
+                {
+                    StageTimer timer(stats.fittingSeconds);
+                    StageMemoryMeter meter(stats.fittingMemory, &arena);
+                    TraceSpan span("fit", "stage");
+                    stats.pixels = countOpaquePixels(image);
+                    for (auto const& record : fitArt(image, settings, report, arena)) {
+                        objects.push(record);
                     }
-                    // if no opt is used
-                    else{
-                        std::string objColour = formatHsvToString(data[pixelIndex], 
-                                    data[pixelIndex + 1], data[pixelIndex + 2]);
-                        placed[y][x] = true;
-                        if(useOldObject){
-                            objInLevel << "1," << currentObjID << ",2," << startX + x * (scale + 2.5f) << ",3," <<
-                            startY - y * (scale + 2.5f) << ",21," << colourChannel << ",41,1,43," <<
-                            objColour << ",25," << zOrder << ",32," << objSize / 5 << ";";
-                        }
-                        else{
-                            objInLevel << "1," << currentObjID << ",2," << (startX + x * scale) 
-                                    << ",3," << (startY - y * scale) << ",21," << colourChannel <<
-                                    ",41,1,43," << objColour << ",25," << zOrder << ",32," << objSize << ";";
-                        }
+                }
+                if (objects.empty()) {
+                    throw std::runtime_error("The image does not have any visible pixels.");
+                }
+                stats.uniqueColours = objects.colours().size();
+                stats.countObjects(objects);
+                std::optional<ArenaString> objString;
+                {
+                    StageTimer timer(stats.serializeSeconds);
+                    StageMemoryMeter meter(stats.serializeMemory, &arena);
+                    TraceSpan span("level string", "stage");
+                    // converts every colour used to the gd format once
+                    ColourPalette palette(objects.colours(), pool, arena);
+                    // writes the objects in the level string format on the pool
+                    objString = buildLevelString(objects, origin, palette, pool, arena);
+                }
+                stats.bytesEmitted = objString->size();
+                stats.imageBytes = static_cast<size_t>(width) * height * channels;
+                stats.placedBytes = PixelMask::bytesFor(width, height) + SquareMap::bytesFor(width, height);
+                stats.objectStoreBytes = objects.memoryBytes();
+                // the chunks and the joined string are alive at the same time
+                stats.stringBytes = objString->size() * 2;
+                // adds the new objects to the level and then prompts the user
+                {
+                    StageTimer timer(stats.insertSeconds);
+                    StageMemoryMeter meter(stats.insertMemory);
+                    TraceSpan span("insert", "stage", {"objects", static_cast<int64_t>(objects.size())});
+                    auto* artObjects = editorLayer->createObjectsFromString(objString->c_str(), true, true);
+                    if (!refineModes.empty()) {
+                        startRefining(artObjects, std::make_unique<ArtRefiner>(image, refineSettings,
+                        refineModes, origin, objects.size(), std::chrono::seconds(refineTime)));
                     }
-                    // skips checking pixels when x stretch is used
-                    x += std::max(1, xStretch);
                 }
+                log::debug("Import used {} arena blocks ({} bytes)", arena.blockCount(), arena.reservedBytes());
             }
-            // removes the last ;
-            objString = objInLevel.str();
-            objString.pop_back();
-            // adds the new objects to the level and then prompts the user
-            auto editorLayer = LevelEditorLayer::get();
-            editorLayer->createObjectsFromString(objString.c_str(), true, true);
-            FLAlertLayer::create("Success!", "Art was imported", "OK")->show();
+            log::info("Imported {}: {}", path, stats.logText());
+            std::string successMessage = "Art was imported\n" + stats.popupText();
+            if (tiledForMemory) {
+                successMessage += "\nIt was imported in tiles as there was not much free memory.";
+            }
+            // lets the user know part of it was not optimised
+            if (report.pastDeadline) {
+                successMessage += fmt::format("\nIt took longer than <cy>{}</c> seconds so the top <cy>{}</c> "
+                "rows were imported as plain rows instead.", timeLimit, report.fallbackRows);
+            }
+            if (report.coloursMerged) {
+                successMessage += fmt::format("\nColours were merged to get it down to <cy>{}</c> objects, "
+                "on average they changed by <cy>{:.1f}</c> delta E.", stats.objects(),
+                report.colourError / std::max<size_t>(report.colourPixels, 1));
+                if (report.overBudget) {
+                    successMessage += fmt::format("\nIt could not fit in the budget of <cy>{}</c> objects.",
+                    objectBudget);
+                }
+            }
+            if (m_fields->m_refiner) {
+                successMessage += fmt::format("\nIt will look for a fit with fewer objects for up to <cy>{}</c> "
+                "seconds and swap it in, press the import button to stop.", refineTime);
+            }
+            if (report.fallbackRegions > 0) {
+                successMessage += fmt::format("\n<cy>{}</c> areas took too long to split exactly and were "
+                "fitted as rectangles instead.", report.fallbackRegions);
+            }
+            FLAlertLayer::create("Success!", successMessage, "OK")->show();
             if (data) {
                 stbi_image_free(data);
                 data = nullptr;
@@ -396,6 +437,13 @@ public:
             std::string errorMessage = e.what();
             FLAlertLayer::create("Error", errorMessage, "OK")->show();
         }
+        // saved even when the import failed as that can be the interesting one
+        if (trace) {
+            auto tracePath = Mod::get()->getSaveDir() / "import-trace.json";
+            std::ofstream file(tracePath);
+            file << trace->toJson();
+            log::info("Wrote {} trace spans to {}", trace->spanCount(), tracePath.string());
+        }
     }
     
     // creates the button that is used to open the pixel art importer
@@ -412,106 +460,11 @@ public:
         // reload it
         m_editButtonBar->reloadItems(rows, cols);
     }
-
-    // converts the rgb values to hsv
-    void rgbToHsv(int red, int green, int blue,
-     float &h, float &s, float &v) {
-        // normalize the rgb values
-        float r = red / 255.0f;
-        float g = green / 255.0f;
-        float b = blue / 255.0f;
-        // find the maximum and minimum
-        float maxColour = std::max(r, std::max(g, b));
-        float minColour = std::min(r, std::min(g, b));
-        // max colour value
-        v = maxColour;
-        // difference between the max and min
-        float delta = maxColour - minColour;
-        // if the difference is less than a small threshold, the colour is grey
-        if (delta < 0.00001f) {
-            s = 0;
-            h = 0;
-            return;
-        }
-        // the difference between the max and min 
-        // colour values divided by the max colour
-        if (maxColour > 0.0) {
-            s = (delta / maxColour);
-        } else {
-            // max colour is 0, the colour is black, so saturation is 0, hue is undefined
-            s = 0.0;
-            h = std::numeric_limits<float>::quiet_NaN();
-            return;
-        }
-        // calculate hue
-        if (r >= maxColour)
-            h = (g - b) / delta;
-        else if (g >= maxColour)
-            h = 2.0f + (b - r) / delta;
-        else
-            h = 4.0f + (r - g) / delta;
-        // convert hue to degrees
-        h *= 60.0f;
-        if (h < 0.0f)
-            // stop it being negative
-            h += 360.0f;
-        // converts colours to the gd format of -180 to 180
-        h = fmodf(h + 180.0f, 360.0f) - 180.0f;
-    }
-
-    // makes hsv a string
-    std::string formatHsvToString(int red, int green, int blue) {
-        float h;
-        float s;
-        float v;
-        rgbToHsv(red, green, blue, h, s, v);
-        if(h == 0){
-            h+=1;
-        }
-        // returns the formated data
-        return std::to_string(h) + "a" + std::to_string(s)
-         + "a" + std::to_string(v) + "a" + "1a1";
-    }
 };
 
-const std::vector<MyEditorUI::OWOShape> MyEditorUI::OWOshapes = {
-    // LargePixelObjID - checks this first as it's a big boy
-    {
-        {
-            {0, 0}, {1, 0}, {2, 0}, {3, 0}, {4, 0}, {5, 0},
-            {0, 1}, {1, 1}, {2, 1}, {3, 1}, {4, 1}, {5, 1},
-            {0, 2}, {1, 2}, {2, 2}, {3, 2}, {4, 2}, {5, 2},
-            {0, 3}, {1, 3}, {2, 3}, {3, 3}, {4, 3}, {5, 3},
-            {0, 4}, {1, 4}, {2, 4}, {3, 4}, {4, 4}, {5, 4},
-            {0, 5}, {1, 5}, {2, 5}, {3, 5}, {4, 5}, {5, 5},
-        },
-        3
-    },
-
-    // bigPixelObjID
-    {
-        {
-            {0, 0}, {1, 0}, {2, 0},
-            {0, 1}, {1, 1}, {2, 1},
-            {0, 2}, {1, 2}, {2, 2}
-        },
-        2
-    },
-
-    // medPixelObjID
-    {
-        {
-            {0, 0}, {1, 0},
-            {0, 1}, {1, 1}
-        },
-        1
-    },
-
-    // PixelObjID
-    {
-        {
-            {0, 0}
-        },
-        0
-    }
-};
+// a refiner still going when the mod goes away would keep using the fitters, so it is stopped
+// first, then the pool's workers are joined while everything they use is still there
+$on_mod(Unloaded) {
+    ArtRefiner::stopAll();
+    ThreadPool::shutdown();
+}
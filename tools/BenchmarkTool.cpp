@@ -0,0 +1,277 @@
+// every import stage as a google benchmark over the generated images, run it with --help for
+// the filter and output flags, the counters hold the objects, memory and picture quality
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include "stb_image.h"
+#include "Colour.hpp"
+#include "CoverageVerifier.hpp"
+#include "ImageCorpus.hpp"
+#include "ImportArena.hpp"
+#include "ImportStats.hpp"
+#include "LevelRasterizer.hpp"
+#include "LevelString.hpp"
+#include "MemoryBudget.hpp"
+#include "ObjectStore.hpp"
+#include "PngWriter.hpp"
+#include "ThreadPool.hpp"
+
+using namespace objects;
+
+namespace {
+    constexpr ArtOrigin benchmarkOrigin{15, 15};
+
+    struct Options {
+        // biggest corpus size to register, the 4096 images take a while to make
+        int maxSize = 1024;
+        unsigned threads = 0;
+        // when set a png of every rendered level string is saved here
+        std::filesystem::path renderDir;
+    };
+
+    Options s_options;
+    // coverage problems found by any verify case, so a script running this sees them
+    std::atomic<size_t> s_problems = 0;
+
+    // the images are only made once a benchmark that needs them runs, so a filter that picks
+    // a few cases does not make the whole corpus first
+    CorpusImage const& corpusImage(CorpusKind kind, int size) {
+        static std::mutex mutex;
+        static std::map<std::pair<CorpusKind, int>, std::unique_ptr<CorpusImage>> images;
+        std::lock_guard lock(mutex);
+        auto& image = images[{kind, size}];
+        if (!image) {
+            image = std::make_unique<CorpusImage>(makeCorpusImage(kind, size));
+        }
+        return *image;
+    }
+
+    // an image fitted once outside the timing, for the stages that work on the objects
+    struct FittedImage {
+        ImportArena arena;
+        ObjectStore objects{arena};
+    };
+
+    std::unique_ptr<FittedImage> fitOnce(ImageView view, FitSettings const& settings) {
+        auto fitted = std::make_unique<FittedImage>();
+        FitReport report;
+        for (auto const& record : fitArt(view, settings, report, fitted->arena)) {
+            fitted->objects.push(record);
+        }
+        return fitted;
+    }
+
+    // runs the timed loop with a fresh arena every iteration and adds the counters the csv
+    // used to have, run returns how many objects it made or wrote
+    template <typename Run>
+    void measure(benchmark::State& state, CorpusImage const& image, Run&& run) {
+        resetPeakResidentMemory();
+        size_t objectCount = 0;
+        StageMemory used;
+        for (auto _ : state) {
+            ImportArena arena;
+            auto counted = countedAllocations();
+            objectCount = run(arena);
+            // every run does the same work so the last one is kept
+            used.allocations = countedAllocations().allocations - counted.allocations + arena.allocationCount();
+            used.allocatedBytes = countedAllocations().allocatedBytes - counted.allocatedBytes +
+                arena.allocatedBytes();
+        }
+        auto pixels = static_cast<int64_t>(image.width) * image.height;
+        state.SetItemsProcessed(state.iterations() * pixels);
+        state.counters["objects"] = static_cast<double>(objectCount);
+        state.counters["objects_per_second"] = benchmark::Counter(static_cast<double>(objectCount),
+            benchmark::Counter::kIsIterationInvariantRate);
+        state.counters["allocations"] = static_cast<double>(used.allocations);
+        state.counters["allocated_bytes"] = benchmark::Counter(static_cast<double>(used.allocatedBytes),
+            benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+        state.counters["peak_rss_bytes"] = benchmark::Counter(static_cast<double>(residentMemory().peak),
+            benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+    }
+
+    void registerImage(CorpusKind kind, int size) {
+        auto name = fmt::format("{}-{}", corpusKindName(kind), size);
+
+        benchmark::RegisterBenchmark(fmt::format("decode/{}", name).c_str(), [=](benchmark::State& state) {
+            auto const& image = corpusImage(kind, size);
+            auto png = encodePng(image.pixels.data(), image.width, image.height);
+            measure(state, image, [&](ImportArena&) {
+                int width;
+                int height;
+                int channels;
+                auto* data = stbi_load_from_memory(png.data(), static_cast<int>(png.size()),
+                    &width, &height, &channels, 0);
+                benchmark::DoNotOptimize(data);
+                stbi_image_free(data);
+                return size_t(0);
+            });
+        });
+
+        benchmark::RegisterBenchmark(fmt::format("rgb-to-hsv/{}", name).c_str(), [=](benchmark::State& state) {
+            auto const& image = corpusImage(kind, size);
+            auto view = image.view();
+            measure(state, image, [&](ImportArena&) {
+                float total = 0;
+                for (int y = 0; y < view.height; ++y) {
+                    for (int x = 0; x < view.width; ++x) {
+                        auto* pixel = view.pixel(x, y);
+                        float h, s, v;
+                        rgbToHsv(pixel[0], pixel[1], pixel[2], h, s, v);
+                        total += s + v;
+                    }
+                }
+                benchmark::DoNotOptimize(total);
+                return size_t(0);
+            });
+        });
+
+        benchmark::RegisterBenchmark(fmt::format("format-hsv/{}", name).c_str(), [=](benchmark::State& state) {
+            auto const& image = corpusImage(kind, size);
+            auto view = image.view();
+            measure(state, image, [&](ImportArena&) {
+                size_t total = 0;
+                for (int y = 0; y < view.height; ++y) {
+                    for (int x = 0; x < view.width; ++x) {
+                        auto* pixel = view.pixel(x, y);
+                        total += formatHsvToString(pixel[0], pixel[1], pixel[2]).size();
+                    }
+                }
+                benchmark::DoNotOptimize(total);
+                return size_t(0);
+            });
+        });
+
+        for (auto const& combination : fitCombinations()) {
+            auto caseName = fmt::format("{}/{}", combination.name, name);
+
+            benchmark::RegisterBenchmark(fmt::format("fit/{}", caseName).c_str(), [=](benchmark::State& state) {
+                auto const& image = corpusImage(kind, size);
+                // the region modes use the pool like a real import would
+                auto settings = combination.settings;
+                settings.pool = &ThreadPool::get(s_options.threads);
+                measure(state, image, [&](ImportArena& arena) {
+                    ObjectStore objects(arena);
+                    FitReport report;
+                    for (auto const& record : fitArt(image.view(), settings, report, arena)) {
+                        objects.push(record);
+                    }
+                    return objects.size();
+                });
+            });
+
+            // checks every fit is still right while measuring how long checking takes
+            benchmark::RegisterBenchmark(fmt::format("verify/{}", caseName).c_str(), [=](benchmark::State& state) {
+                auto const& image = corpusImage(kind, size);
+                auto fitted = fitOnce(image.view(), combination.settings);
+                VerifyOptions options{combination.allowOverlap, combination.allowRecolour};
+                size_t problems = 0;
+                measure(state, image, [&](ImportArena&) {
+                    problems = verifyCoverage(image.view(), fitted->objects, options).problemCount();
+                    return fitted->objects.size();
+                });
+                state.counters["problems"] = static_cast<double>(problems);
+                if (problems > 0) {
+                    s_problems += problems;
+                    state.SkipWithError(fmt::format("the verifier found {} coverage problems", problems).c_str());
+                }
+            });
+
+            benchmark::RegisterBenchmark(fmt::format("level-string/{}", caseName).c_str(),
+                [=](benchmark::State& state) {
+                auto const& image = corpusImage(kind, size);
+                auto fitted = fitOnce(image.view(), combination.settings);
+                auto& pool = ThreadPool::get(s_options.threads);
+                measure(state, image, [&](ImportArena& arena) {
+                    ColourPalette palette(fitted->objects.colours(), pool, arena);
+                    auto levelString = buildLevelString(fitted->objects, benchmarkOrigin, palette, pool, arena);
+                    benchmark::DoNotOptimize(levelString.size());
+                    return fitted->objects.size();
+                });
+            });
+
+            // draws the level string back into a picture to see how close it is to the image
+            benchmark::RegisterBenchmark(fmt::format("render/{}", caseName).c_str(), [=](benchmark::State& state) {
+                auto const& image = corpusImage(kind, size);
+                auto fitted = fitOnce(image.view(), combination.settings);
+                auto& pool = ThreadPool::get(s_options.threads);
+                ImportArena stringArena;
+                ColourPalette palette(fitted->objects.colours(), pool, stringArena);
+                auto levelString = buildLevelString(fitted->objects, benchmarkOrigin, palette, pool, stringArena);
+                RasterOptions rasterOptions{benchmarkOrigin, image.width, image.height,
+                    pixelSpacing(combination.settings.useOldObject ? oldPixelObjID : pixelObjID)};
+                Raster raster;
+                ImageQuality quality;
+                measure(state, image, [&](ImportArena&) {
+                    raster = rasterizeLevelString(levelString, rasterOptions);
+                    quality = compareImages(image.view(), raster.view());
+                    return raster.drawnObjects;
+                });
+                state.counters["psnr"] = quality.psnr;
+                state.counters["ssim"] = quality.ssim;
+                if (!s_options.renderDir.empty()) {
+                    writePng(s_options.renderDir / fmt::format("{}-{}.png", image.name, combination.name),
+                        raster.pixels.data(), raster.width, raster.height);
+                }
+            });
+        }
+    }
+
+    void printUsage() {
+        fmt::print(stderr,
+            "artimporter-benchmark options, next to the --benchmark_ ones:\n"
+            "  --max-size <pixels>    biggest generated image to run, default 1024\n"
+            "  --threads <count>      most threads to fit with, 0 uses every core, default 0\n"
+            "  --renders <folder>     saves every rendered level string as a png in the folder\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    // what google benchmark did not take is ours
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        char const* value = argv[++i];
+        if (arg == "--max-size") {
+            s_options.maxSize = std::atoi(value);
+        }
+        else if (arg == "--threads") {
+            s_options.threads = static_cast<unsigned>(std::atoi(value));
+        }
+        else if (arg == "--renders") {
+            s_options.renderDir = value;
+            std::filesystem::create_directories(s_options.renderDir);
+        }
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    for (int size : corpusSizes()) {
+        if (size > s_options.maxSize) {
+            continue;
+        }
+        for (auto kind : corpusKinds()) {
+            registerImage(kind, size);
+        }
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    ThreadPool::shutdown();
+    return s_problems > 0 ? 1 : 0;
+}
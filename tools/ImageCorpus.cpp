@@ -0,0 +1,235 @@
+#include "ImageCorpus.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+    // small random number generator so every platform makes the same images
+    class Random {
+    public:
+        explicit Random(uint32_t seed) : m_state(seed ? seed : 1) {}
+        uint32_t next() {
+            m_state ^= m_state << 13;
+            m_state ^= m_state >> 17;
+            m_state ^= m_state << 5;
+            return m_state;
+        }
+        int below(int limit) { return static_cast<int>(next() % static_cast<uint32_t>(limit)); }
+
+    private:
+        uint32_t m_state;
+    };
+
+    // palette the flat, pixel art and dithered images pick from
+    constexpr uint8_t palette[16][3] = {
+        {0, 0, 0}, {255, 255, 255}, {136, 0, 0}, {170, 255, 238},
+        {204, 68, 204}, {0, 204, 85}, {0, 0, 170}, {238, 238, 119},
+        {221, 136, 85}, {102, 68, 0}, {255, 119, 119}, {51, 51, 51},
+        {119, 119, 119}, {170, 255, 102}, {0, 136, 255}, {187, 187, 187},
+    };
+
+    void setPixel(CorpusImage& image, int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+        auto* pixel = image.pixels.data() + (static_cast<size_t>(y) * image.width + x) * 4;
+        pixel[0] = r;
+        pixel[1] = g;
+        pixel[2] = b;
+        pixel[3] = a;
+    }
+
+    void fillRect(CorpusImage& image, int left, int top, int width, int height, uint8_t const* colour) {
+        for (int y = std::max(top, 0); y < std::min(top + height, image.height); ++y) {
+            for (int x = std::max(left, 0); x < std::min(left + width, image.width); ++x) {
+                setPixel(image, x, y, colour[0], colour[1], colour[2]);
+            }
+        }
+    }
+
+    void makeFlat(CorpusImage& image, Random& random) {
+        fillRect(image, 0, 0, image.width, image.height, palette[3]);
+        for (int i = 0; i < 6; ++i) {
+            int width = image.width / 4 + random.below(image.width / 2 + 1);
+            int height = image.height / 4 + random.below(image.height / 2 + 1);
+            fillRect(image, random.below(image.width), random.below(image.height), width, height,
+                palette[random.below(16)]);
+        }
+    }
+
+    void makeNoisy(CorpusImage& image, Random& random) {
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                uint32_t value = random.next();
+                setPixel(image, x, y, value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff);
+            }
+        }
+    }
+
+    void makePixelArt(CorpusImage& image, Random& random) {
+        // transparent background with blocky shapes and outlines on top
+        std::fill(image.pixels.begin(), image.pixels.end(), 0);
+        int shapes = std::max(4, image.width * image.height / 400);
+        for (int i = 0; i < shapes; ++i) {
+            int size = 2 + random.below(std::max(2, image.width / 8));
+            int left = random.below(image.width);
+            int top = random.below(image.height);
+            auto* colour = palette[random.below(16)];
+            // circles with an outline or plain rectangles
+            if (random.below(2)) {
+                int radius = size / 2 + 1;
+                for (int y = -radius; y <= radius; ++y) {
+                    for (int x = -radius; x <= radius; ++x) {
+                        int distance = x * x + y * y;
+                        int px = left + x;
+                        int py = top + y;
+                        if (px < 0 || py < 0 || px >= image.width || py >= image.height ||
+                            distance > radius * radius) {
+                            continue;
+                        }
+                        auto* fill = distance > (radius - 1) * (radius - 1) ? palette[0] : colour;
+                        setPixel(image, px, py, fill[0], fill[1], fill[2]);
+                    }
+                }
+            }
+            else {
+                fillRect(image, left, top, size, size / 2 + 1, colour);
+            }
+        }
+    }
+
+    void makeDithered(CorpusImage& image, Random& random) {
+        // 4 by 4 ordered dither of a diagonal gradient over 4 colours
+        static constexpr int bayer[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+        int colours[4];
+        for (auto& colour : colours) {
+            colour = random.below(16);
+        }
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                // gradient from 0 to 3 * 16 across the image
+                int level = (x + y) * 48 / (image.width + image.height);
+                int band = std::min(2, level / 16);
+                int step = level % 16 > bayer[y % 4][x % 4] ? band + 1 : band;
+                auto* colour = palette[colours[step]];
+                setPixel(image, x, y, colour[0], colour[1], colour[2]);
+            }
+        }
+    }
+
+    void makePhotoLike(CorpusImage& image, Random& random) {
+        int offset = random.below(64);
+        for (int y = 0; y < image.height; ++y) {
+            for (int x = 0; x < image.width; ++x) {
+                // smooth ramps in each channel with a little grain
+                int grain = random.below(5) - 2;
+                int r = x * 255 / image.width;
+                int g = y * 255 / image.height;
+                int b = ((x + y) / 2 + offset) * 255 / image.width;
+                setPixel(image, x, y,
+                    static_cast<uint8_t>(std::clamp(r + grain, 0, 255)),
+                    static_cast<uint8_t>(std::clamp(g + grain, 0, 255)),
+                    static_cast<uint8_t>(std::clamp(b % 256 + grain, 0, 255)));
+            }
+        }
+    }
+}
+
+std::vector<CorpusKind> const& corpusKinds() {
+    static const std::vector<CorpusKind> kinds = {
+        CorpusKind::Flat, CorpusKind::Noisy, CorpusKind::PixelArt, CorpusKind::Dithered, CorpusKind::PhotoLike,
+    };
+    return kinds;
+}
+
+char const* corpusKindName(CorpusKind kind) {
+    switch (kind) {
+        case CorpusKind::Flat: return "flat";
+        case CorpusKind::Noisy: return "noisy";
+        case CorpusKind::PixelArt: return "pixel-art";
+        case CorpusKind::Dithered: return "dithered";
+        case CorpusKind::PhotoLike: return "photo-like";
+    }
+    return "unknown";
+}
+
+CorpusImage makeCorpusImage(CorpusKind kind, int size) {
+    CorpusImage image;
+    image.kind = kind;
+    image.width = size;
+    image.height = size;
+    image.name = std::string(corpusKindName(kind)) + "-" + std::to_string(size);
+    image.pixels.resize(static_cast<size_t>(size) * size * 4, 255);
+    Random random(static_cast<uint32_t>(size) * 31 + static_cast<uint32_t>(kind) * 7919 + 1);
+    switch (kind) {
+        case CorpusKind::Flat: makeFlat(image, random); break;
+        case CorpusKind::Noisy: makeNoisy(image, random); break;
+        case CorpusKind::PixelArt: makePixelArt(image, random); break;
+        case CorpusKind::Dithered: makeDithered(image, random); break;
+        case CorpusKind::PhotoLike: makePhotoLike(image, random); break;
+    }
+    return image;
+}
+
+std::vector<int> const& corpusSizes() {
+    static const std::vector<int> sizes = {32, 128, 512, 1024, 2048, 4096};
+    return sizes;
+}
+
+std::vector<FitCombination> const& fitCombinations() {
+    static const std::vector<FitCombination> combinations = [] {
+        std::vector<FitCombination> list;
+        FitSettings plain;
+        plain.optimise = false;
+        list.push_back({"plain", plain});
+        FitSettings oldObjects;
+        oldObjects.optimise = false;
+        oldObjects.useOldObject = true;
+        list.push_back({"old-objects", oldObjects});
+        // squares are placed over same coloured pixels even if they are already covered
+        FitSettings squares;
+        list.push_back({"squares", squares, true});
+        FitSettings scaled;
+        scaled.useScaling = true;
+        list.push_back({"squares-scaled", scaled, true});
+        FitSettings rectangles;
+        rectangles.mode = FitMode::Rectangles;
+        list.push_back({"rectangles", rectangles});
+        FitSettings partition;
+        partition.mode = FitMode::Partition;
+        list.push_back({"partition", partition});
+        FitSettings runs;
+        runs.mode = FitMode::Runs;
+        list.push_back({"runs", runs});
+        FitSettings layered;
+        layered.mode = FitMode::Layered;
+        list.push_back({"layered", layered});
+        FitSettings quadtree;
+        quadtree.mode = FitMode::Quadtree;
+        list.push_back({"quadtree", quadtree});
+        FitSettings rectangleTiles;
+        rectangleTiles.mode = FitMode::Rectangles;
+        rectangleTiles.parallelTiles = true;
+        list.push_back({"rectangles-tiles", rectangleTiles});
+        FitSettings partitionTiles;
+        partitionTiles.mode = FitMode::Partition;
+        partitionTiles.parallelTiles = true;
+        list.push_back({"partition-tiles", partitionTiles});
+        FitSettings runTiles;
+        runTiles.mode = FitMode::Runs;
+        runTiles.parallelTiles = true;
+        list.push_back({"runs-tiles", runTiles});
+        // the layered mode ignores the tiles, this makes sure it keeps doing so
+        FitSettings layeredTiles;
+        layeredTiles.mode = FitMode::Layered;
+        layeredTiles.parallelTiles = true;
+        list.push_back({"layered-tiles", layeredTiles});
+        FitSettings quadtreeTiles;
+        quadtreeTiles.mode = FitMode::Quadtree;
+        quadtreeTiles.parallelTiles = true;
+        list.push_back({"quadtree-tiles", quadtreeTiles});
+        // colours that look alike are merged so pixels can end up another colour
+        FitSettings budget;
+        budget.mode = FitMode::Budget;
+        budget.objectBudget = 2000;
+        list.push_back({"budget", budget, false, true});
+        return list;
+    }();
+    return combinations;
+}
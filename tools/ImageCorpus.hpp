@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ArtFitter.hpp"
+#include "ImageView.hpp"
+
+// the kinds of images the importer gets measured on
+enum class CorpusKind {
+    // a few big flat areas
+    Flat,
+    // every pixel a random colour, the worst case
+    Noisy,
+    // blocky shapes from a small palette on a transparent background
+    PixelArt,
+    // a gradient dithered between a few colours
+    Dithered,
+    // smooth gradients with a little grain, lots of unique colours
+    PhotoLike,
+};
+
+// an rgba image made from a fixed seed so it is the same on every device
+struct CorpusImage {
+    CorpusKind kind;
+    std::string name;
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    ImageView view() const { return ImageView{pixels.data(), width, height, 4}; }
+};
+
+std::vector<CorpusKind> const& corpusKinds();
+char const* corpusKindName(CorpusKind kind);
+
+// makes a square corpus image of the given size
+CorpusImage makeCorpusImage(CorpusKind kind, int size);
+
+// sizes the corpus comes in, from 32 by 32 up to 4096 by 4096
+std::vector<int> const& corpusSizes();
+
+// a named combination of the fitting settings
+struct FitCombination {
+    char const* name;
+    FitSettings settings;
+    // objects can cover pixels another object already covers
+    bool allowOverlap = false;
+    // objects can be another colour than the pixels they cover
+    bool allowRecolour = false;
+};
+
+// every combination of settings the importer supports, new ones need
+// their object counts adding to the regression check
+std::vector<FitCombination> const& fitCombinations();
@@ -0,0 +1,298 @@
+#include "LevelRasterizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "Colour.hpp"
+
+using namespace objects;
+
+namespace {
+    // one object read back out of the string
+    struct ParsedObject {
+        int objectID = 0;
+        double x = 0;
+        double y = 0;
+        double scaleX = 1;
+        double scaleY = 1;
+        int zOrder = 0;
+        uint8_t red = 0;
+        uint8_t green = 0;
+        uint8_t blue = 0;
+    };
+
+    // strtod needs a null on the end, numbers in level strings are short
+    bool parseNumber(std::string_view text, double& value) {
+        char buffer[64];
+        if (text.empty() || text.size() >= sizeof(buffer)) {
+            return false;
+        }
+        std::copy(text.begin(), text.end(), buffer);
+        buffer[text.size()] = '\0';
+        char* end = nullptr;
+        value = std::strtod(buffer, &end);
+        return end == buffer + text.size();
+    }
+
+    // hsv is written as hue a saturation a value a 1 a 1
+    bool parseHsv(std::string_view text, ParsedObject& object) {
+        double values[3];
+        for (double& value : values) {
+            auto split = text.find('a');
+            if (split == std::string_view::npos || !parseNumber(text.substr(0, split), value)) {
+                return false;
+            }
+            text.remove_prefix(split + 1);
+        }
+        int red;
+        int green;
+        int blue;
+        // the colour channel is black so the hsv is the whole colour
+        hsvToRgb(static_cast<float>(values[0]), static_cast<float>(values[1]), static_cast<float>(values[2]),
+            red, green, blue);
+        object.red = static_cast<uint8_t>(red);
+        object.green = static_cast<uint8_t>(green);
+        object.blue = static_cast<uint8_t>(blue);
+        return true;
+    }
+
+    bool parseObject(std::string_view text, ParsedObject& object) {
+        bool hasID = false;
+        bool hasScaleX = false;
+        bool hasScaleY = false;
+        double scale = 1;
+        while (!text.empty()) {
+            auto keyEnd = text.find(',');
+            if (keyEnd == std::string_view::npos) {
+                return false;
+            }
+            auto key = text.substr(0, keyEnd);
+            text.remove_prefix(keyEnd + 1);
+            auto valueEnd = std::min(text.find(','), text.size());
+            auto valueText = text.substr(0, valueEnd);
+            text.remove_prefix(std::min(valueEnd + 1, text.size()));
+            if (key == "43") {
+                if (!parseHsv(valueText, object)) {
+                    return false;
+                }
+                continue;
+            }
+            double value;
+            if (!parseNumber(valueText, value)) {
+                return false;
+            }
+            if (key == "1") {
+                object.objectID = static_cast<int>(value);
+                hasID = true;
+            }
+            else if (key == "2") {
+                object.x = value;
+            }
+            else if (key == "3") {
+                object.y = value;
+            }
+            else if (key == "25") {
+                object.zOrder = static_cast<int>(value);
+            }
+            else if (key == "32") {
+                scale = value;
+            }
+            else if (key == "128") {
+                object.scaleX = value;
+                hasScaleX = true;
+            }
+            else if (key == "129") {
+                object.scaleY = value;
+                hasScaleY = true;
+            }
+        }
+        // the x and y scale are multiplied by the normal one
+        object.scaleX = (hasScaleX ? object.scaleX : 1) * scale;
+        object.scaleY = (hasScaleY ? object.scaleY : 1) * scale;
+        return hasID;
+    }
+
+    bool importerObject(int objectID) {
+        return objectID == pixelObjID || objectID == medPixelObjID || objectID == bigPixelObjID ||
+            objectID == largePixelObjID || objectID == oldPixelObjID;
+    }
+
+    // every object the importer could have made, the rest are counted as skipped
+    std::vector<ParsedObject> parseLevelString(std::string_view levelString, size_t& skipped) {
+        std::vector<ParsedObject> parsed;
+        while (!levelString.empty()) {
+            auto end = std::min(levelString.find(';'), levelString.size());
+            auto objectText = levelString.substr(0, end);
+            levelString.remove_prefix(std::min(end + 1, levelString.size()));
+            if (objectText.empty()) {
+                continue;
+            }
+            ParsedObject object;
+            if (!parseObject(objectText, object) || !importerObject(object.objectID)) {
+                skipped++;
+                continue;
+            }
+            parsed.push_back(object);
+        }
+        return parsed;
+    }
+
+    // rgba with transparent pixels as black so both images are compared the same way
+    void premultiplied(ImageView image, int x, int y, double out[4]) {
+        if (x >= image.width || y >= image.height || !image.isOpaque(x, y)) {
+            out[0] = out[1] = out[2] = out[3] = 0;
+            return;
+        }
+        auto* pixel = image.pixel(x, y);
+        double alpha = image.channels == 4 ? pixel[3] : 255;
+        for (int channel = 0; channel < 3; ++channel) {
+            out[channel] = pixel[channel] * alpha / 255.0;
+        }
+        out[3] = alpha;
+    }
+}
+
+Raster rasterizeLevelString(std::string_view levelString, RasterOptions const& options) {
+    Raster raster;
+    raster.width = options.width;
+    raster.height = options.height;
+    raster.pixels.assign(static_cast<size_t>(options.width) * options.height * 4, 0);
+
+    auto parsed = parseLevelString(levelString, raster.skippedObjects);
+    // higher z goes on top, objects on the same z are drawn in order
+    std::stable_sort(parsed.begin(), parsed.end(), [](ParsedObject const& a, ParsedObject const& b) {
+        return a.zOrder < b.zOrder;
+    });
+
+    for (auto const& object : parsed) {
+        // level units to pixels, pixel centres are whole numbers plus a half
+        double halfWidth = unscaledSize(object.objectID) * object.scaleX / 2 / options.pixelSpacing;
+        double halfHeight = unscaledSize(object.objectID) * object.scaleY / 2 / options.pixelSpacing;
+        double centreX = (object.x - options.origin.x) / options.pixelSpacing + 0.5;
+        // y goes up in the level and down in the image
+        double centreY = (options.origin.y - object.y) / options.pixelSpacing + 0.5;
+        // covers every pixel whose centre is inside the object
+        int left = std::max(0, static_cast<int>(std::ceil(centreX - halfWidth - 0.5)));
+        int right = std::min(options.width, static_cast<int>(std::ceil(centreX + halfWidth - 0.5)));
+        int top = std::max(0, static_cast<int>(std::ceil(centreY - halfHeight - 0.5)));
+        int bottom = std::min(options.height, static_cast<int>(std::ceil(centreY + halfHeight - 0.5)));
+        for (int y = top; y < bottom; ++y) {
+            for (int x = left; x < right; ++x) {
+                auto* pixel = raster.pixels.data() + (static_cast<size_t>(y) * options.width + x) * 4;
+                pixel[0] = object.red;
+                pixel[1] = object.green;
+                pixel[2] = object.blue;
+                pixel[3] = 255;
+            }
+        }
+        raster.drawnObjects++;
+    }
+    return raster;
+}
+
+std::optional<RasterOptions> guessRasterOptions(std::string_view levelString) {
+    size_t skipped = 0;
+    auto parsed = parseLevelString(levelString, skipped);
+    if (parsed.empty()) {
+        return std::nullopt;
+    }
+    RasterOptions options;
+    // one old pixel means the art was made with them, the two kinds are never mixed
+    bool oldObjects = std::any_of(parsed.begin(), parsed.end(), [](ParsedObject const& object) {
+        return object.objectID == oldPixelObjID;
+    });
+    options.pixelSpacing = pixelSpacing(oldObjects ? oldPixelObjID : pixelObjID);
+    double left = std::numeric_limits<double>::infinity();
+    double right = -left;
+    double top = -left;
+    double bottom = left;
+    for (auto const& object : parsed) {
+        double halfWidth = unscaledSize(object.objectID) * object.scaleX / 2;
+        double halfHeight = unscaledSize(object.objectID) * object.scaleY / 2;
+        left = std::min(left, object.x - halfWidth);
+        right = std::max(right, object.x + halfWidth);
+        top = std::max(top, object.y + halfHeight);
+        bottom = std::min(bottom, object.y - halfHeight);
+    }
+    // the origin is the centre of the top left pixel
+    options.origin = ArtOrigin{static_cast<float>(left + options.pixelSpacing / 2),
+        static_cast<float>(top - options.pixelSpacing / 2)};
+    options.width = static_cast<int>(std::lround((right - left) / options.pixelSpacing));
+    options.height = static_cast<int>(std::lround((top - bottom) / options.pixelSpacing));
+    return options;
+}
+
+ImageQuality compareImages(ImageView source, ImageView rendered) {
+    ImageQuality quality;
+    int width = std::max(source.width, rendered.width);
+    int height = std::max(source.height, rendered.height);
+    if (width == 0 || height == 0) {
+        quality.psnr = std::numeric_limits<double>::infinity();
+        quality.ssim = 1;
+        return quality;
+    }
+
+    // brightness of every pixel for the ssim, filled while the psnr is added up
+    std::vector<double> sourceLuma(static_cast<size_t>(width) * height);
+    std::vector<double> renderedLuma(sourceLuma.size());
+    double squaredError = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double a[4];
+            double b[4];
+            premultiplied(source, x, y, a);
+            premultiplied(rendered, x, y, b);
+            for (int channel = 0; channel < 4; ++channel) {
+                squaredError += (a[channel] - b[channel]) * (a[channel] - b[channel]);
+            }
+            size_t index = static_cast<size_t>(y) * width + x;
+            sourceLuma[index] = 0.299 * a[0] + 0.587 * a[1] + 0.114 * a[2];
+            renderedLuma[index] = 0.299 * b[0] + 0.587 * b[1] + 0.114 * b[2];
+        }
+    }
+    double meanError = squaredError / (static_cast<double>(width) * height * 4);
+    quality.psnr = meanError == 0 ? std::numeric_limits<double>::infinity()
+        : 10 * std::log10(255.0 * 255.0 / meanError);
+
+    // ssim over 8 by 8 windows that overlap by half
+    constexpr int window = 8;
+    constexpr int step = 4;
+    constexpr double c1 = (0.01 * 255) * (0.01 * 255);
+    constexpr double c2 = (0.03 * 255) * (0.03 * 255);
+    double total = 0;
+    size_t windows = 0;
+    int windowWidth = std::min(window, width);
+    int windowHeight = std::min(window, height);
+    for (int top = 0; top + windowHeight <= height; top += step) {
+        for (int left = 0; left + windowWidth <= width; left += step) {
+            double sumA = 0;
+            double sumB = 0;
+            double sumAA = 0;
+            double sumBB = 0;
+            double sumAB = 0;
+            for (int y = top; y < top + windowHeight; ++y) {
+                for (int x = left; x < left + windowWidth; ++x) {
+                    size_t index = static_cast<size_t>(y) * width + x;
+                    double a = sourceLuma[index];
+                    double b = renderedLuma[index];
+                    sumA += a;
+                    sumB += b;
+                    sumAA += a * a;
+                    sumBB += b * b;
+                    sumAB += a * b;
+                }
+            }
+            double count = static_cast<double>(windowWidth) * windowHeight;
+            double meanA = sumA / count;
+            double meanB = sumB / count;
+            double varianceA = sumAA / count - meanA * meanA;
+            double varianceB = sumBB / count - meanB * meanB;
+            double covariance = sumAB / count - meanA * meanB;
+            total += ((2 * meanA * meanB + c1) * (2 * covariance + c2)) /
+                ((meanA * meanA + meanB * meanB + c1) * (varianceA + varianceB + c2));
+            windows++;
+        }
+    }
+    quality.ssim = windows ? total / windows : 1;
+    return quality;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "ImageView.hpp"
+#include "LevelString.hpp"
+#include "ObjectRecord.hpp"
+
+// where the art was built and how big the picture of it should be
+struct RasterOptions {
+    ArtOrigin origin{0, 0};
+    int width = 0;
+    int height = 0;
+    // level units between pixel centres, the old pixel object uses its own spacing
+    double pixelSpacing = objects::scale;
+};
+
+// rgba picture of a level string, anything no object covers is transparent
+struct Raster {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+    size_t drawnObjects = 0;
+    // objects that could not be read or have an ID the importer does not make
+    size_t skippedObjects = 0;
+
+    ImageView view() const { return ImageView{pixels.data(), width, height, 4}; }
+};
+
+// reads the objects back out of an importer level string and draws them the
+// way the editor would, by z order and then in the order they were added
+Raster rasterizeLevelString(std::string_view levelString, RasterOptions const& options);
+
+// works out where the art starts and how big it is from the objects themselves, for level
+// strings copied out of the game where the selected object is not known, the art's top row
+// and left column are assumed to have something in them, nothing when there are no pixels
+std::optional<RasterOptions> guessRasterOptions(std::string_view levelString);
+
+struct ImageQuality {
+    // peak signal to noise ratio in db, infinite when the images match
+    double psnr = 0;
+    // structural similarity from 0 to 1, 1 when the images match
+    double ssim = 0;
+};
+
+// compares a picture with the image it was made from, both as rgba with
+// transparent pixels counted as black
+ImageQuality compareImages(ImageView source, ImageView rendered);
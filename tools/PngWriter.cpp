@@ -0,0 +1,271 @@
+#include "PngWriter.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+    // deflate can only look this far back for a match
+    constexpr size_t windowSize = 32768;
+    constexpr size_t minMatch = 3;
+    constexpr size_t maxMatch = 258;
+    // how many earlier places with the same first bytes are tried, like zlib's middle levels
+    constexpr int maxChain = 32;
+    constexpr int hashBits = 15;
+
+    constexpr std::array<uint16_t, 29> lengthBase = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr std::array<uint8_t, 29> lengthExtra = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr std::array<uint16_t, 30> distanceBase = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    constexpr std::array<uint8_t, 30> distanceExtra = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    // deflate writes the bits of a byte from the lowest up
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<unsigned char>& out) : m_out(out) {}
+
+        void bits(uint32_t value, int count) {
+            m_buffer |= value << m_count;
+            m_count += count;
+            while (m_count >= 8) {
+                m_out.push_back(static_cast<unsigned char>(m_buffer));
+                m_buffer >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        // huffman codes go in from their highest bit
+        void code(uint32_t value, int count) {
+            uint32_t reversed = 0;
+            for (int bit = 0; bit < count; ++bit) {
+                reversed = (reversed << 1) | ((value >> bit) & 1);
+            }
+            bits(reversed, count);
+        }
+
+        void flush() {
+            if (m_count > 0) {
+                m_out.push_back(static_cast<unsigned char>(m_buffer));
+            }
+            m_buffer = 0;
+            m_count = 0;
+        }
+
+    private:
+        std::vector<unsigned char>& m_out;
+        uint32_t m_buffer = 0;
+        int m_count = 0;
+    };
+
+    // the fixed codes from the deflate spec, literals and lengths share one alphabet
+    void writeSymbol(BitWriter& writer, int symbol) {
+        if (symbol < 144) {
+            writer.code(0x30 + symbol, 8);
+        }
+        else if (symbol < 256) {
+            writer.code(0x190 + symbol - 144, 9);
+        }
+        else if (symbol < 280) {
+            writer.code(symbol - 256, 7);
+        }
+        else {
+            writer.code(0xc0 + symbol - 280, 8);
+        }
+    }
+
+    void writeMatch(BitWriter& writer, size_t length, size_t distance) {
+        size_t lengthCode = std::upper_bound(lengthBase.begin(), lengthBase.end(), length) - lengthBase.begin() - 1;
+        writeSymbol(writer, static_cast<int>(257 + lengthCode));
+        writer.bits(static_cast<uint32_t>(length - lengthBase[lengthCode]), lengthExtra[lengthCode]);
+        size_t distanceCode = std::upper_bound(distanceBase.begin(), distanceBase.end(), distance) -
+            distanceBase.begin() - 1;
+        writer.code(static_cast<uint32_t>(distanceCode), 5);
+        writer.bits(static_cast<uint32_t>(distance - distanceBase[distanceCode]), distanceExtra[distanceCode]);
+    }
+
+    // one block with the fixed codes, the matches are found by chaining earlier places
+    // that start with the same three bytes
+    void deflate(std::vector<unsigned char> const& data, std::vector<unsigned char>& out) {
+        BitWriter writer(out);
+        // last block, fixed codes
+        writer.bits(1, 1);
+        writer.bits(1, 2);
+        std::vector<int32_t> head(size_t(1) << hashBits, -1);
+        std::vector<int32_t> previous(windowSize, -1);
+        auto hash = [&](size_t at) {
+            uint32_t value = (data[at] << 16) | (data[at + 1] << 8) | data[at + 2];
+            return (value * 2654435761u) >> (32 - hashBits);
+        };
+        auto insert = [&](size_t at) {
+            if (at + minMatch <= data.size()) {
+                auto& first = head[hash(at)];
+                previous[at % windowSize] = first;
+                first = static_cast<int32_t>(at);
+            }
+        };
+        size_t at = 0;
+        while (at < data.size()) {
+            size_t bestLength = 0;
+            size_t bestDistance = 0;
+            if (at + minMatch <= data.size()) {
+                size_t longest = std::min(maxMatch, data.size() - at);
+                int32_t candidate = head[hash(at)];
+                for (int chain = 0; chain < maxChain && candidate >= 0 && at - candidate <= windowSize; ++chain) {
+                    size_t length = 0;
+                    while (length < longest && data[candidate + length] == data[at + length]) {
+                        length++;
+                    }
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = at - candidate;
+                        if (length == longest) {
+                            break;
+                        }
+                    }
+                    int32_t next = previous[candidate % windowSize];
+                    // the slot was reused by a newer place, the chain ends here
+                    if (next >= candidate) {
+                        break;
+                    }
+                    candidate = next;
+                }
+            }
+            if (bestLength >= minMatch) {
+                writeMatch(writer, bestLength, bestDistance);
+                for (size_t i = 0; i < bestLength; ++i) {
+                    insert(at + i);
+                }
+                at += bestLength;
+            }
+            else {
+                writeSymbol(writer, data[at]);
+                insert(at);
+                at++;
+            }
+        }
+        writeSymbol(writer, 256);
+        writer.flush();
+    }
+
+    unsigned char paeth(int left, int up, int upLeft) {
+        int estimate = left + up - upLeft;
+        int toLeft = std::abs(estimate - left);
+        int toUp = std::abs(estimate - up);
+        int toUpLeft = std::abs(estimate - upLeft);
+        if (toLeft <= toUp && toLeft <= toUpLeft) {
+            return static_cast<unsigned char>(left);
+        }
+        return static_cast<unsigned char>(toUp <= toUpLeft ? up : upLeft);
+    }
+
+    std::array<uint32_t, 256> makeCrcTable() {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    uint32_t crc32(unsigned char const* data, size_t size, uint32_t crc = 0) {
+        static const auto table = makeCrcTable();
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void appendBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+        out.push_back(static_cast<unsigned char>(value >> 24));
+        out.push_back(static_cast<unsigned char>(value >> 16));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    void appendChunk(std::vector<unsigned char>& out, char const* type, std::vector<unsigned char> const& data) {
+        appendBigEndian(out, static_cast<uint32_t>(data.size()));
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        appendBigEndian(out, crc32(out.data() + start, out.size() - start));
+    }
+}
+
+std::vector<unsigned char> encodePng(unsigned char const* rgba, int width, int height) {
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    std::vector<unsigned char> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    // 8 bits per channel, rgba, default compression, filter and no interlacing
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    appendChunk(png, "IHDR", header);
+
+    // every row gets the filter that leaves the smallest numbers, the same guess libpng makes
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+    std::vector<unsigned char> raw;
+    raw.reserve((rowBytes + 1) * height);
+    std::vector<unsigned char> zeroRow(rowBytes, 0);
+    std::array<std::vector<unsigned char>, 5> filtered;
+    for (auto& row : filtered) {
+        row.resize(rowBytes);
+    }
+    for (int y = 0; y < height; ++y) {
+        auto* row = rgba + y * rowBytes;
+        auto* above = y > 0 ? row - rowBytes : zeroRow.data();
+        size_t bestFilter = 0;
+        size_t bestScore = SIZE_MAX;
+        for (size_t filter = 0; filter < filtered.size(); ++filter) {
+            size_t score = 0;
+            for (size_t i = 0; i < rowBytes; ++i) {
+                int left = i >= 4 ? row[i - 4] : 0;
+                int upLeft = i >= 4 ? above[i - 4] : 0;
+                int predicted = 0;
+                switch (filter) {
+                    case 1: predicted = left; break;
+                    case 2: predicted = above[i]; break;
+                    case 3: predicted = (left + above[i]) / 2; break;
+                    case 4: predicted = paeth(left, above[i], upLeft); break;
+                }
+                auto value = static_cast<unsigned char>(row[i] - predicted);
+                filtered[filter][i] = value;
+                score += value < 128 ? value : 256 - value;
+            }
+            if (score < bestScore) {
+                bestScore = score;
+                bestFilter = filter;
+            }
+        }
+        raw.push_back(static_cast<unsigned char>(bestFilter));
+        raw.insert(raw.end(), filtered[bestFilter].begin(), filtered[bestFilter].end());
+    }
+
+    std::vector<unsigned char> zlib = {0x78, 0x5e};
+    deflate(raw, zlib);
+    // adler32 of the uncompressed data
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (unsigned char byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+bool writePng(std::filesystem::path const& path, unsigned char const* rgba, int width, int height) {
+    auto png = encodePng(rgba, width, height);
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(png.data()), static_cast<std::streamsize>(png.size()));
+    return static_cast<bool>(file);
+}
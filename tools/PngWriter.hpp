@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// encodes rgba pixels as a png, filtered and compressed like an image editor would so
+// decoding one takes as long as decoding a real import
+std::vector<unsigned char> encodePng(unsigned char const* rgba, int width, int height);
+
+// encodes and writes a png, returns false if the file could not be written
+bool writePng(std::filesystem::path const& path, unsigned char const* rgba, int width, int height);
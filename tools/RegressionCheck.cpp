@@ -0,0 +1,444 @@
+#include "RegressionCheck.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+#include <sstream>
+#include "ImageCorpus.hpp"
+#include "ImportArena.hpp"
+#include "MemoryBudget.hpp"
+#include "ObjectStore.hpp"
+
+namespace {
+    struct GoldenCount {
+        char const* image;
+        char const* combination;
+        size_t objects;
+    };
+
+    // object counts the fitter made when the check was added
+    // more objects than this fails, fewer passes but should be written in
+    // here so the improvement is kept
+    constexpr GoldenCount goldenCounts[] = {
+        {"flat-32", "plain", 1024},
+        {"flat-32", "old-objects", 1024},
+        {"flat-32", "squares", 116},
+        {"flat-32", "squares-scaled", 66},
+        {"flat-32", "rectangles", 15},
+        {"flat-32", "partition", 15},
+        {"flat-32", "runs", 16},
+        {"flat-32", "layered", 8},
+        {"flat-32", "quadtree", 106},
+        {"flat-32", "rectangles-tiles", 15},
+        {"flat-32", "partition-tiles", 15},
+        {"flat-32", "runs-tiles", 16},
+        {"flat-32", "layered-tiles", 8},
+        {"flat-32", "quadtree-tiles", 106},
+        {"flat-32", "budget", 15},
+        {"noisy-32", "plain", 1024},
+        {"noisy-32", "old-objects", 1024},
+        {"noisy-32", "squares", 1024},
+        {"noisy-32", "squares-scaled", 1024},
+        {"noisy-32", "rectangles", 1024},
+        {"noisy-32", "partition", 1024},
+        {"noisy-32", "runs", 1024},
+        {"noisy-32", "layered", 1024},
+        {"noisy-32", "quadtree", 1024},
+        {"noisy-32", "rectangles-tiles", 1024},
+        {"noisy-32", "partition-tiles", 1024},
+        {"noisy-32", "runs-tiles", 1024},
+        {"noisy-32", "layered-tiles", 1024},
+        {"noisy-32", "quadtree-tiles", 1024},
+        {"noisy-32", "budget", 1024},
+        {"pixel-art-32", "plain", 34},
+        {"pixel-art-32", "old-objects", 34},
+        {"pixel-art-32", "squares", 28},
+        {"pixel-art-32", "squares-scaled", 20},
+        {"pixel-art-32", "rectangles", 20},
+        {"pixel-art-32", "partition", 20},
+        {"pixel-art-32", "runs", 21},
+        {"pixel-art-32", "layered", 14},
+        {"pixel-art-32", "quadtree", 28},
+        {"pixel-art-32", "rectangles-tiles", 20},
+        {"pixel-art-32", "partition-tiles", 20},
+        {"pixel-art-32", "runs-tiles", 21},
+        {"pixel-art-32", "layered-tiles", 14},
+        {"pixel-art-32", "quadtree-tiles", 28},
+        {"pixel-art-32", "budget", 20},
+        {"dithered-32", "plain", 1024},
+        {"dithered-32", "old-objects", 1024},
+        {"dithered-32", "squares", 747},
+        {"dithered-32", "squares-scaled", 596},
+        {"dithered-32", "rectangles", 574},
+        {"dithered-32", "partition", 570},
+        {"dithered-32", "runs", 579},
+        {"dithered-32", "layered", 334},
+        {"dithered-32", "quadtree", 763},
+        {"dithered-32", "rectangles-tiles", 574},
+        {"dithered-32", "partition-tiles", 570},
+        {"dithered-32", "runs-tiles", 579},
+        {"dithered-32", "layered-tiles", 334},
+        {"dithered-32", "quadtree-tiles", 763},
+        {"dithered-32", "budget", 574},
+        {"photo-like-32", "plain", 1024},
+        {"photo-like-32", "old-objects", 1024},
+        {"photo-like-32", "squares", 1024},
+        {"photo-like-32", "squares-scaled", 1024},
+        {"photo-like-32", "rectangles", 1024},
+        {"photo-like-32", "partition", 1024},
+        {"photo-like-32", "runs", 1024},
+        {"photo-like-32", "layered", 1024},
+        {"photo-like-32", "quadtree", 1024},
+        {"photo-like-32", "rectangles-tiles", 1024},
+        {"photo-like-32", "partition-tiles", 1024},
+        {"photo-like-32", "runs-tiles", 1024},
+        {"photo-like-32", "layered-tiles", 1024},
+        {"photo-like-32", "quadtree-tiles", 1024},
+        {"photo-like-32", "budget", 1024},
+        {"flat-128", "plain", 16384},
+        {"flat-128", "old-objects", 16384},
+        {"flat-128", "squares", 954},
+        {"flat-128", "squares-scaled", 653},
+        {"flat-128", "rectangles", 18},
+        {"flat-128", "partition", 18},
+        {"flat-128", "runs", 18},
+        {"flat-128", "layered", 11},
+        {"flat-128", "quadtree", 725},
+        {"flat-128", "rectangles-tiles", 18},
+        {"flat-128", "partition-tiles", 18},
+        {"flat-128", "runs-tiles", 18},
+        {"flat-128", "layered-tiles", 11},
+        {"flat-128", "quadtree-tiles", 725},
+        {"flat-128", "budget", 18},
+        {"noisy-128", "plain", 16384},
+        {"noisy-128", "old-objects", 16384},
+        {"noisy-128", "squares", 16384},
+        {"noisy-128", "squares-scaled", 16384},
+        {"noisy-128", "rectangles", 16384},
+        {"noisy-128", "partition", 16384},
+        {"noisy-128", "runs", 16384},
+        {"noisy-128", "layered", 16384},
+        {"noisy-128", "quadtree", 16384},
+        {"noisy-128", "rectangles-tiles", 16384},
+        {"noisy-128", "partition-tiles", 16384},
+        {"noisy-128", "runs-tiles", 16384},
+        {"noisy-128", "layered-tiles", 16384},
+        {"noisy-128", "quadtree-tiles", 16384},
+        {"noisy-128", "budget", 1979},
+        {"pixel-art-128", "plain", 3023},
+        {"pixel-art-128", "old-objects", 3023},
+        {"pixel-art-128", "squares", 1115},
+        {"pixel-art-128", "squares-scaled", 598},
+        {"pixel-art-128", "rectangles", 478},
+        {"pixel-art-128", "partition", 475},
+        {"pixel-art-128", "runs", 490},
+        {"pixel-art-128", "layered", 334},
+        {"pixel-art-128", "quadtree", 1105},
+        {"pixel-art-128", "rectangles-tiles", 478},
+        {"pixel-art-128", "partition-tiles", 475},
+        {"pixel-art-128", "runs-tiles", 490},
+        {"pixel-art-128", "layered-tiles", 334},
+        {"pixel-art-128", "quadtree-tiles", 1105},
+        {"pixel-art-128", "budget", 478},
+        {"dithered-128", "plain", 16384},
+        {"dithered-128", "old-objects", 16384},
+        {"dithered-128", "squares", 11855},
+        {"dithered-128", "squares-scaled", 9175},
+        {"dithered-128", "rectangles", 8670},
+        {"dithered-128", "partition", 8654},
+        {"dithered-128", "runs", 8693},
+        {"dithered-128", "layered", 5162},
+        {"dithered-128", "quadtree", 12205},
+        {"dithered-128", "rectangles-tiles", 8670},
+        {"dithered-128", "partition-tiles", 8654},
+        {"dithered-128", "runs-tiles", 8693},
+        {"dithered-128", "layered-tiles", 5162},
+        {"dithered-128", "quadtree-tiles", 12205},
+        {"dithered-128", "budget", 1999},
+        {"photo-like-128", "plain", 16384},
+        {"photo-like-128", "old-objects", 16384},
+        {"photo-like-128", "squares", 16384},
+        {"photo-like-128", "squares-scaled", 16366},
+        {"photo-like-128", "rectangles", 16366},
+        {"photo-like-128", "partition", 16366},
+        {"photo-like-128", "runs", 16366},
+        {"photo-like-128", "layered", 16366},
+        {"photo-like-128", "quadtree", 16374},
+        {"photo-like-128", "rectangles-tiles", 16366},
+        {"photo-like-128", "partition-tiles", 16366},
+        {"photo-like-128", "runs-tiles", 16366},
+        {"photo-like-128", "layered-tiles", 16366},
+        {"photo-like-128", "quadtree-tiles", 16374},
+        {"photo-like-128", "budget", 1999},
+        {"flat-512", "plain", 262144},
+        {"flat-512", "old-objects", 262144},
+        {"flat-512", "squares", 8279},
+        {"flat-512", "squares-scaled", 7754},
+        {"flat-512", "rectangles", 21},
+        {"flat-512", "partition", 20},
+        {"flat-512", "runs", 19},
+        {"flat-512", "layered", 18},
+        {"flat-512", "quadtree", 1472},
+        {"flat-512", "rectangles-tiles", 20},
+        {"flat-512", "partition-tiles", 21},
+        {"flat-512", "runs-tiles", 19},
+        {"flat-512", "layered-tiles", 18},
+        {"flat-512", "quadtree-tiles", 1440},
+        {"flat-512", "budget", 21},
+        {"noisy-512", "plain", 262144},
+        {"noisy-512", "old-objects", 262144},
+        {"noisy-512", "squares", 262144},
+        {"noisy-512", "squares-scaled", 262144},
+        {"noisy-512", "rectangles", 262144},
+        {"noisy-512", "partition", 262144},
+        {"noisy-512", "runs", 262144},
+        {"noisy-512", "layered", 262144},
+        {"noisy-512", "quadtree", 262144},
+        {"noisy-512", "rectangles-tiles", 262144},
+        {"noisy-512", "partition-tiles", 262144},
+        {"noisy-512", "runs-tiles", 262144},
+        {"noisy-512", "layered-tiles", 262144},
+        {"noisy-512", "quadtree-tiles", 262144},
+        {"noisy-512", "budget", 9},
+        {"pixel-art-512", "plain", 224670},
+        {"pixel-art-512", "old-objects", 224670},
+        {"pixel-art-512", "squares", 33010},
+        {"pixel-art-512", "squares-scaled", 19090},
+        {"pixel-art-512", "rectangles", 10359},
+        {"pixel-art-512", "partition", 9865},
+        {"pixel-art-512", "runs", 10475},
+        {"pixel-art-512", "layered", 6878},
+        {"pixel-art-512", "quadtree", 32224},
+        {"pixel-art-512", "rectangles-tiles", 10491},
+        {"pixel-art-512", "partition-tiles", 9895},
+        {"pixel-art-512", "runs-tiles", 10475},
+        {"pixel-art-512", "layered-tiles", 6878},
+        {"pixel-art-512", "quadtree-tiles", 32073},
+        {"pixel-art-512", "budget", 1997},
+        {"dithered-512", "plain", 262144},
+        {"dithered-512", "old-objects", 262144},
+        {"dithered-512", "squares", 86263},
+        {"dithered-512", "squares-scaled", 66527},
+        {"dithered-512", "rectangles", 59087},
+        {"dithered-512", "partition", 58833},
+        {"dithered-512", "runs", 59207},
+        {"dithered-512", "layered", 29225},
+        {"dithered-512", "quadtree", 85390},
+        {"dithered-512", "rectangles-tiles", 58851},
+        {"dithered-512", "partition-tiles", 58833},
+        {"dithered-512", "runs-tiles", 59207},
+        {"dithered-512", "layered-tiles", 29225},
+        {"dithered-512", "quadtree-tiles", 85307},
+        {"dithered-512", "budget", 1994},
+        {"photo-like-512", "plain", 262144},
+        {"photo-like-512", "old-objects", 262144},
+        {"photo-like-512", "squares", 261427},
+        {"photo-like-512", "squares-scaled", 228205},
+        {"photo-like-512", "rectangles", 228205},
+        {"photo-like-512", "partition", 228203},
+        {"photo-like-512", "runs", 228223},
+        {"photo-like-512", "layered", 228205},
+        {"photo-like-512", "quadtree", 251096},
+        {"photo-like-512", "rectangles-tiles", 228205},
+        {"photo-like-512", "partition-tiles", 228203},
+        {"photo-like-512", "runs-tiles", 228223},
+        {"photo-like-512", "layered-tiles", 228205},
+        {"photo-like-512", "quadtree-tiles", 250951},
+        {"photo-like-512", "budget", 1913},
+        {"flat-1024", "plain", 1048576},
+        {"flat-1024", "old-objects", 1048576},
+        {"flat-1024", "squares", 33430},
+        {"flat-1024", "squares-scaled", 30374},
+        {"flat-1024", "rectangles", 54},
+        {"flat-1024", "partition", 54},
+        {"flat-1024", "runs", 52},
+        {"flat-1024", "layered", 50},
+        {"flat-1024", "quadtree", 5085},
+        {"flat-1024", "rectangles-tiles", 64},
+        {"flat-1024", "partition-tiles", 67},
+        {"flat-1024", "runs-tiles", 55},
+        {"flat-1024", "layered-tiles", 50},
+        {"flat-1024", "quadtree-tiles", 4981},
+        {"flat-1024", "budget", 54},
+        {"noisy-1024", "plain", 1048576},
+        {"noisy-1024", "old-objects", 1048576},
+        {"noisy-1024", "squares", 1048576},
+        {"noisy-1024", "squares-scaled", 1048576},
+        {"noisy-1024", "rectangles", 1048576},
+        {"noisy-1024", "partition", 1048576},
+        {"noisy-1024", "runs", 1048576},
+        {"noisy-1024", "layered", 1048576},
+        {"noisy-1024", "quadtree", 1048576},
+        {"noisy-1024", "rectangles-tiles", 1048576},
+        {"noisy-1024", "partition-tiles", 1048576},
+        {"noisy-1024", "runs-tiles", 1048576},
+        {"noisy-1024", "layered-tiles", 1048576},
+        {"noisy-1024", "quadtree-tiles", 1048576},
+        {"noisy-1024", "budget", 36},
+        {"pixel-art-1024", "plain", 1048330},
+        {"pixel-art-1024", "old-objects", 1048330},
+        {"pixel-art-1024", "squares", 112031},
+        {"pixel-art-1024", "squares-scaled", 68537},
+        {"pixel-art-1024", "rectangles", 28729},
+        {"pixel-art-1024", "partition", 27416},
+        {"pixel-art-1024", "runs", 29436},
+        {"pixel-art-1024", "layered", 27486},
+        {"pixel-art-1024", "quadtree", 92678},
+        {"pixel-art-1024", "rectangles-tiles", 29639},
+        {"pixel-art-1024", "partition-tiles", 27630},
+        {"pixel-art-1024", "runs-tiles", 29436},
+        {"pixel-art-1024", "layered-tiles", 27486},
+        {"pixel-art-1024", "quadtree-tiles", 92164},
+        {"pixel-art-1024", "budget", 99},
+        {"dithered-1024", "plain", 1048576},
+        {"dithered-1024", "old-objects", 1048576},
+        {"dithered-1024", "squares", 343919},
+        {"dithered-1024", "squares-scaled", 265569},
+        {"dithered-1024", "rectangles", 236118},
+        {"dithered-1024", "partition", 235158},
+        {"dithered-1024", "runs", 236465},
+        {"dithered-1024", "layered", 116870},
+        {"dithered-1024", "quadtree", 340856},
+        {"dithered-1024", "rectangles-tiles", 234623},
+        {"dithered-1024", "partition-tiles", 234960},
+        {"dithered-1024", "runs-tiles", 236467},
+        {"dithered-1024", "layered-tiles", 116870},
+        {"dithered-1024", "quadtree-tiles", 340420},
+        {"dithered-1024", "budget", 1338},
+        {"photo-like-1024", "plain", 1048576},
+        {"photo-like-1024", "old-objects", 1048576},
+        {"photo-like-1024", "squares", 1038742},
+        {"photo-like-1024", "squares-scaled", 829491},
+        {"photo-like-1024", "rectangles", 829434},
+        {"photo-like-1024", "partition", 828237},
+        {"photo-like-1024", "runs", 832587},
+        {"photo-like-1024", "layered", 829434},
+        {"photo-like-1024", "quadtree", 972339},
+        {"photo-like-1024", "rectangles-tiles", 829473},
+        {"photo-like-1024", "partition-tiles", 828245},
+        {"photo-like-1024", "runs-tiles", 832587},
+        {"photo-like-1024", "layered-tiles", 829434},
+        {"photo-like-1024", "quadtree-tiles", 971398},
+        {"photo-like-1024", "budget", 36},
+    };
+
+    // tiny cases finish in microseconds so timer noise gets some room as well
+    constexpr double timeSlackSeconds = 0.002;
+
+    std::optional<size_t> findGoldenCount(std::string const& image, char const* combination) {
+        for (auto const& golden : goldenCounts) {
+            if (image == golden.image && std::strcmp(combination, golden.combination) == 0) {
+                return golden.objects;
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+std::vector<RegressionResult> runRegressionCheck(RegressionOptions const& options,
+    std::function<void(RegressionResult const&)> const& onResult) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<RegressionResult> results;
+    for (int size : corpusSizes()) {
+        if (size > options.maxSize) {
+            continue;
+        }
+        for (auto kind : corpusKinds()) {
+            auto image = makeCorpusImage(kind, size);
+            auto view = image.view();
+            for (auto const& combination : fitCombinations()) {
+                RegressionResult result;
+                result.image = image.name;
+                result.combination = combination.name;
+                result.goldenObjects = findGoldenCount(image.name, combination.name);
+                resetPeakResidentMemory();
+                for (int run = 0; run < std::max(options.repeats, 1); ++run) {
+                    ImportArena arena;
+                    ObjectStore objects(arena);
+                    FitReport report;
+                    auto start = Clock::now();
+                    for (auto const& record : fitArt(view, combination.settings, report, arena)) {
+                        objects.push(record);
+                    }
+                    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                    result.seconds = run == 0 ? seconds : std::min(result.seconds, seconds);
+                    // every run makes the same objects so only the first is checked
+                    if (run == 0) {
+                        result.objects = objects.size();
+                        result.allocations = arena.allocationCount();
+                        result.allocatedBytes = arena.allocatedBytes();
+                        result.coverage = verifyCoverage(view, objects, VerifyOptions{combination.allowOverlap, combination.allowRecolour});
+                    }
+                }
+
+                if (result.goldenObjects && result.objects > *result.goldenObjects) {
+                    result.failures.push_back(fmt::format("{} objects, expected at most {}",
+                        result.objects, *result.goldenObjects));
+                }
+                if (!result.coverage.passed()) {
+                    result.failures.push_back(result.coverage.describe());
+                }
+                result.peakResidentBytes = residentMemory().peak;
+                auto baseline = options.baseline.find(result.key());
+                if (baseline != options.baseline.end()) {
+                    result.ceilingSeconds = baseline->second.seconds * (1 + options.timeTolerance) + timeSlackSeconds;
+                    if (result.seconds > *result.ceilingSeconds) {
+                        result.failures.push_back(fmt::format("took {:.3f} ms, the limit is {:.3f} ms",
+                            result.seconds * 1000, *result.ceilingSeconds * 1000));
+                    }
+                    // the same fit always asks for the same memory so this does not need slack
+                    if (baseline->second.allocatedBytes) {
+                        result.ceilingBytes = static_cast<size_t>(*baseline->second.allocatedBytes *
+                            (1 + options.memoryTolerance));
+                        if (result.allocatedBytes > *result.ceilingBytes) {
+                            result.failures.push_back(fmt::format("allocated {} bytes, the limit is {} bytes",
+                                result.allocatedBytes, *result.ceilingBytes));
+                        }
+                    }
+                }
+                if (onResult) {
+                    onResult(result);
+                }
+                results.push_back(std::move(result));
+            }
+        }
+    }
+    return results;
+}
+
+std::string formatRegressionBaseline(std::vector<RegressionResult> const& results) {
+    // the last two are only for reading, the check does not use them
+    std::string csv = "case,seconds,allocated_bytes,allocations,peak_rss_bytes\n";
+    for (auto const& result : results) {
+        csv += fmt::format("{},{:.9f},{},{},{}\n", result.key(), result.seconds, result.allocatedBytes,
+            result.allocations, result.peakResidentBytes);
+    }
+    return csv;
+}
+
+RegressionBaseline parseRegressionBaseline(std::string const& csv) {
+    RegressionBaseline baseline;
+    std::istringstream stream(csv);
+    std::string line;
+    // skips the header
+    std::getline(stream, line);
+    while (std::getline(stream, line)) {
+        auto comma = line.find(',');
+        if (comma == std::string::npos) {
+            continue;
+        }
+        try {
+            BaselineCase entry;
+            auto secondComma = line.find(',', comma + 1);
+            entry.seconds = std::stod(line.substr(comma + 1, secondComma - comma - 1));
+            // older baselines only have the time
+            if (secondComma != std::string::npos) {
+                entry.allocatedBytes = static_cast<size_t>(std::stoull(line.substr(secondComma + 1)));
+            }
+            baseline[line.substr(0, comma)] = entry;
+        } catch (std::exception const&) {
+            // a broken line just means that case is not checked
+        }
+    }
+    return baseline;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CoverageVerifier.hpp"
+
+// what a case used in an earlier run
+struct BaselineCase {
+    double seconds = 0;
+    // nothing for baselines saved before memory was tracked
+    std::optional<size_t> allocatedBytes;
+};
+
+// earlier runs keyed by "image/combination"
+using RegressionBaseline = std::unordered_map<std::string, BaselineCase>;
+
+struct RegressionOptions {
+    // biggest corpus size to check, the object counts are known up to 1024
+    int maxSize = 1024;
+    // how much slower than the baseline a case can get before it fails
+    double timeTolerance = 0.25;
+    // the same fit always asks for the same memory, so this only leaves room for small changes
+    double memoryTolerance = 0.1;
+    // each case is fitted this many times and the fastest run is kept
+    int repeats = 3;
+    // left empty the times and memory are only recorded, not checked
+    RegressionBaseline baseline;
+};
+
+// one corpus image fitted with one combination of settings
+struct RegressionResult {
+    std::string image;
+    std::string combination;
+    size_t objects = 0;
+    // nothing when there is no known count for this case
+    std::optional<size_t> goldenObjects;
+    // fastest fit of all the repeats
+    double seconds = 0;
+    std::optional<double> ceilingSeconds;
+    // arena allocations one fit made
+    size_t allocations = 0;
+    size_t allocatedBytes = 0;
+    std::optional<size_t> ceilingBytes;
+    // most memory used while the case ran, or since the start where that can not be reset,
+    // 0 when it can not be read
+    size_t peakResidentBytes = 0;
+    CoverageReport coverage;
+    // why the case failed, empty when it passed
+    std::vector<std::string> failures;
+
+    std::string key() const { return image + "/" + combination; }
+    bool passed() const { return failures.empty(); }
+};
+
+// fits every corpus image with every combination and checks the object count
+// against the known counts, the coverage against the image and the time
+// against the baseline, calling onResult as each case finishes
+std::vector<RegressionResult> runRegressionCheck(RegressionOptions const& options,
+    std::function<void(RegressionResult const&)> const& onResult = {});
+
+// saves and loads the times and memory so the next run has something to compare with
+std::string formatRegressionBaseline(std::vector<RegressionResult> const& results);
+RegressionBaseline parseRegressionBaseline(std::string const& csv);
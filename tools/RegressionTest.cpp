@@ -0,0 +1,103 @@
+// fits the generated images with every combination of settings and fails when an object
+// count, the coverage, a time or the memory got worse than the checked in baseline
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <fmt/format.h>
+#include "RegressionCheck.hpp"
+
+namespace {
+    void printUsage() {
+        fmt::print(stderr,
+            "usage: artimporter-regression [options]\n"
+            "  --baseline <file>             times and memory to compare with, without it they are only printed\n"
+            "  --write-baseline <file>       saves this run's times and memory for later runs to compare with\n"
+            "  --max-size <pixels>           biggest generated image to check, default 1024\n"
+            "  --time-tolerance <percent>    how much slower than the baseline a case can get, default 25\n"
+            "  --memory-tolerance <percent>  how much more memory than the baseline a case can use, default 10\n"
+            "  --repeats <count>             fits each case this many times and keeps the fastest, default 3\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    RegressionOptions options;
+    std::filesystem::path baselinePath;
+    std::filesystem::path writePath;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        char const* value = argv[++i];
+        if (arg == "--baseline") {
+            baselinePath = value;
+        }
+        else if (arg == "--write-baseline") {
+            writePath = value;
+        }
+        else if (arg == "--max-size") {
+            options.maxSize = std::atoi(value);
+        }
+        else if (arg == "--time-tolerance") {
+            options.timeTolerance = std::atof(value) / 100.0;
+        }
+        else if (arg == "--memory-tolerance") {
+            options.memoryTolerance = std::atof(value) / 100.0;
+        }
+        else if (arg == "--repeats") {
+            options.repeats = std::atoi(value);
+        }
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (!baselinePath.empty()) {
+        std::ifstream file(baselinePath);
+        if (!file) {
+            fmt::print(stderr, "could not read {}\n", baselinePath.string());
+            return 2;
+        }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        options.baseline = parseRegressionBaseline(contents.str());
+    }
+
+    size_t failed = 0;
+    auto results = runRegressionCheck(options, [&](RegressionResult const& result) {
+        if (result.passed()) {
+            fmt::print("{}: passed, {} objects in {:.3f} ms, {} allocations of {} bytes, peak {:.1f} MB\n",
+                result.key(), result.objects, result.seconds * 1000, result.allocations, result.allocatedBytes,
+                result.peakResidentBytes / (1024.0 * 1024.0));
+            return;
+        }
+        failed++;
+        for (auto const& failure : result.failures) {
+            fmt::print("{}: FAILED, {}\n", result.key(), failure);
+        }
+    });
+
+    if (!writePath.empty()) {
+        std::ofstream file(writePath);
+        file << formatRegressionBaseline(results);
+        if (!file) {
+            fmt::print(stderr, "could not write {}\n", writePath.string());
+            return 2;
+        }
+    }
+    if (failed > 0) {
+        fmt::print("{} of {} cases failed\n", failed, results.size());
+        return 1;
+    }
+    fmt::print("all {} cases passed\n", results.size());
+    return 0;
+}
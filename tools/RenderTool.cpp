@@ -0,0 +1,148 @@
+// draws a level string back into a picture without the game and says how close it is to
+// the image it was imported from
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#include "stb_image.h"
+#include "LevelRasterizer.hpp"
+#include "PngWriter.hpp"
+
+namespace {
+    void printUsage() {
+        fmt::print(stderr,
+            "usage: artimporter-render <level string file> <image> [options]\n"
+            "  --origin <x>,<y>   centre of the art's top left pixel in the level, guessed from the\n"
+            "                     objects and the image when it is not given\n"
+            "  --save <png>       saves the drawn picture\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    std::filesystem::path levelPath;
+    std::filesystem::path imagePath;
+    std::optional<ArtOrigin> origin;
+    std::filesystem::path savePath;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        }
+        if (!arg.starts_with("--")) {
+            if (levelPath.empty()) {
+                levelPath = argv[i];
+            }
+            else if (imagePath.empty()) {
+                imagePath = argv[i];
+            }
+            else {
+                printUsage();
+                return 2;
+            }
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        char const* value = argv[++i];
+        if (arg == "--origin") {
+            float x;
+            float y;
+            if (std::sscanf(value, "%f,%f", &x, &y) != 2) {
+                printUsage();
+                return 2;
+            }
+            origin = ArtOrigin{x, y};
+        }
+        else if (arg == "--save") {
+            savePath = value;
+        }
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (levelPath.empty() || imagePath.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    std::ifstream file(levelPath, std::ios::binary);
+    if (!file) {
+        fmt::print(stderr, "could not read {}\n", levelPath.string());
+        return 1;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    auto levelString = contents.str();
+    // copied strings often end in a new line
+    while (!levelString.empty() && (levelString.back() == '\n' || levelString.back() == '\r')) {
+        levelString.pop_back();
+    }
+
+    int width;
+    int height;
+    int channels;
+    auto* data = stbi_load(imagePath.string().c_str(), &width, &height, &channels, 0);
+    if (!data) {
+        fmt::print(stderr, "could not read {}: {}\n", imagePath.string(), stbi_failure_reason());
+        return 1;
+    }
+    ImageView image{data, width, height, channels};
+
+    auto options = guessRasterOptions(levelString);
+    if (!options) {
+        fmt::print(stderr, "{} has no pixel objects in it\n", levelPath.string());
+        stbi_image_free(data);
+        return 1;
+    }
+    if (origin) {
+        options->origin = *origin;
+    }
+    else {
+        // the objects start at the first pixel that is not transparent, so the origin moves
+        // back by however many empty rows and columns the image has before it
+        int firstColumn = width;
+        int firstRow = height;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (image.isOpaque(x, y)) {
+                    firstColumn = std::min(firstColumn, x);
+                    firstRow = std::min(firstRow, y);
+                }
+            }
+        }
+        if (firstColumn < width) {
+            options->origin.x -= static_cast<float>(firstColumn * options->pixelSpacing);
+            options->origin.y += static_cast<float>(firstRow * options->pixelSpacing);
+        }
+        if (options->width + firstColumn > width || options->height + firstRow > height) {
+            fmt::print(stderr, "the art is {}x{} but the image is {}x{}, pass --origin if it is not the "
+                "image it was imported from\n", options->width, options->height, width, height);
+        }
+    }
+    // the picture is the size of the image so the two line up pixel for pixel
+    options->width = width;
+    options->height = height;
+
+    auto raster = rasterizeLevelString(levelString, *options);
+    auto quality = compareImages(image, raster.view());
+    fmt::print("origin {},{}\n", options->origin.x, options->origin.y);
+    fmt::print("{} objects drawn, {} skipped\n", raster.drawnObjects, raster.skippedObjects);
+    fmt::print("psnr {:.2f} db\nssim {:.5f}\n", quality.psnr, quality.ssim);
+    stbi_image_free(data);
+
+    if (!savePath.empty() && !writePng(savePath, raster.pixels.data(), raster.width, raster.height)) {
+        fmt::print(stderr, "could not write {}\n", savePath.string());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,9 @@
+// the mod builds the decoder into main.cpp, the tools get it from here
+#include <cstdlib>
+#include "ImportStats.hpp"
+// counts what the decoder allocates like the import does
+#define STBI_MALLOC(size) countedMalloc(size)
+#define STBI_REALLOC(pointer, size) countedRealloc(pointer, size)
+#define STBI_FREE(pointer) std::free(pointer)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"